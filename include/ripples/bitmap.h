@@ -14,6 +14,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <set>
@@ -43,8 +45,51 @@ void encodeRR0(InItr in_begin, size_t local_idx, size_t length, size_t n_ints, u
 }
 
 
+//! \brief Hands out the columns of the per-thread bitmaps of a round to RRR
+//! sets encoded by any thread.
+//!
+//! The columns are numbered across the bitmaps, so the sets of a chunk get
+//! consecutive columns whatever thread sampled them.  Two chunks may share a
+//! word of a bitmap, so the bits are set atomically.
+class BitmapColumns {
+ public:
+  //! \param blockR The bitmaps, n_ints words per vertex each.
+  //! \param n_ints The number of words of a row of a bitmap.
+  void reset(std::vector<unsigned int*> *blockR, size_t n_ints) {
+    blockR_ = blockR;
+    n_ints_ = n_ints;
+    next_ = 0;
+  }
+
+  //! Reserve count consecutive columns and return the first one.
+  size_t reserve(size_t count) { return next_.fetch_add(count); }
+
+  //! Set the bits of an RRR set in a column obtained with reserve().
+  template <typename RRRset>
+  void encode(const RRRset &set, size_t column) {
+    size_t columns = n_ints_ * 32;
+    unsigned int *code_array = (*blockR_)[column / columns];
+    size_t local_idx = column % columns;
+    unsigned int m = 1u << (local_idx % 32);
+    for (auto vtx_id : set) {
+      unsigned int *word = code_array + vtx_id * n_ints_ + local_idx / 32;
+#pragma omp atomic
+      *word |= m;
+    }
+  }
+
+ private:
+  std::vector<unsigned int*> *blockR_{nullptr};
+  size_t n_ints_{0};
+  std::atomic<size_t> next_{0};
+};
+
+//! The optional seeded counts are RRR sets kept out of the bitmaps.  They are
+//! split evenly among the counters of the threads, as if the sets had been
+//! spread over the bitmaps, here as in countRR02, selectRR20 and selectRR202.
 void countRR0(std::vector<std::vector<unsigned int*>> &blockR, const size_t n_vtx, std::vector<size_t> n_ints,
-			 size_t *local_m, size_t *local_v, size_t &maxvtx, size_t &maxcnt){
+			 size_t *local_m, size_t *local_v, size_t &maxvtx, size_t &maxcnt,
+			 const uint32_t *seeded = nullptr){
 	size_t num_threads = omp_get_max_threads();
 	size_t n_xs = n_ints.size();
 	size_t* globalcnt=(size_t*)malloc(n_vtx*sizeof(size_t));
@@ -67,6 +112,7 @@ void countRR0(std::vector<std::vector<unsigned int*>> &blockR, const size_t n_vt
 		// }
 		// // }
 		// for (i = 0;i<n_vtx;i++) {
+			if (seeded && seeded[i]) localcnt[i] += (seeded[i] + num_threads - 1 - rank) / num_threads;
 			if (localcnt[i] > local_max){
 				local_max = localcnt[i];
 				local_vtx = i;
@@ -108,7 +154,8 @@ void countRR0(std::vector<std::vector<unsigned int*>> &blockR, const size_t n_vt
 
 void countRR02(std::vector<std::vector<unsigned int*>> &blockR1, std::vector<unsigned int*> &blockR2, 
 			const size_t n_vtx, std::vector<size_t> n_ints1, size_t n_ints2,
-			size_t *local_m, size_t *local_v, size_t &maxvtx, size_t &maxcnt){
+			size_t *local_m, size_t *local_v, size_t &maxvtx, size_t &maxcnt,
+			const uint32_t *seeded = nullptr){
 	size_t num_threads = omp_get_max_threads();
 	size_t n_xs = n_ints1.size();
 	size_t* globalcnt=(size_t*)calloc(n_vtx,sizeof(size_t));
@@ -136,6 +183,7 @@ void countRR02(std::vector<std::vector<unsigned int*>> &blockR1, std::vector<uns
 		}
 		// }
 		for (i = 0;i<n_vtx;i++) {
+			if (seeded && seeded[i]) localcnt[i] += (seeded[i] + num_threads - 1 - rank) / num_threads;
 			if (localcnt[i] > local_max){
 				local_max = localcnt[i];
 				local_vtx = i;
@@ -176,7 +224,8 @@ void countRR02(std::vector<std::vector<unsigned int*>> &blockR1, std::vector<uns
 }
 
 void selectRR20(std::vector<std::vector<unsigned int*>> &blockR, const size_t n_vtx, std::vector<size_t> n_ints,
-			 size_t *local_m, size_t *local_v, std::vector<bool *> &deleteflag, size_t &maxk, size_t &maxv){
+			 size_t *local_m, size_t *local_v, std::vector<bool *> &deleteflag, size_t &maxk, size_t &maxv,
+			 const uint32_t *seeded = nullptr){
 	size_t num_threads = omp_get_max_threads();
 	size_t n_xs = n_ints.size();
 	
@@ -210,6 +259,7 @@ void selectRR20(std::vector<std::vector<unsigned int*>> &blockR, const size_t n_
 						localcnt[i] += __builtin_popcount(blockR[x][rank][i*n_ints[x] + j]);
 					}
 				}
+				if (seeded && seeded[i]) localcnt[i] += (seeded[i] + num_threads - 1 - rank) / num_threads;
 			}
 			if (localcnt[i] > local_max){
 				local_max = localcnt[i];
@@ -252,7 +302,8 @@ void selectRR20(std::vector<std::vector<unsigned int*>> &blockR, const size_t n_
 
 void selectRR202(std::vector<std::vector<unsigned int*>> &blockR1, std::vector<unsigned int*> &blockR2, 
 			 const size_t n_vtx, std::vector<size_t> n_ints1, const size_t n_ints2,
-			 size_t *local_m, size_t *local_v, std::vector<bool *> &deleteflag, size_t &maxk, size_t &maxv){
+			 size_t *local_m, size_t *local_v, std::vector<bool *> &deleteflag, size_t &maxk, size_t &maxv,
+			 const uint32_t *seeded = nullptr){
 	size_t num_threads = omp_get_max_threads();
 	size_t n_xs = n_ints1.size();
 	
@@ -284,6 +335,7 @@ void selectRR202(std::vector<std::vector<unsigned int*>> &blockR1, std::vector<u
 					blockR2[rank][i*n_ints2 + j] &= tmp1;
 					localcnt[i] += __builtin_popcount(blockR2[rank][i*n_ints2 + j]);
 				}
+				if (seeded && seeded[i]) localcnt[i] += (seeded[i] + num_threads - 1 - rank) / num_threads;
 				if (localcnt[i] > local_max){
 					local_max = localcnt[i];
 					local_vtx = i;
@@ -0,0 +1,349 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_COMPRESSED_GRAPH_H
+#define RIPPLES_COMPRESSED_GRAPH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "ripples/graph.h"
+#include "ripples/utility.h"
+
+namespace ripples {
+
+//! \brief Byte-aligned variable length encoding of unsigned integers.
+//!
+//! Each byte stores 7 bits of the value, least significant first; the high
+//! bit marks that more bytes follow.
+struct varint {
+  //! The number of bytes needed to encode a value.
+  static size_t size(uint64_t v) {
+    size_t s = 1;
+    for (; v >= 0x80; v >>= 7) ++s;
+    return s;
+  }
+
+  //! Encode a value.
+  //! \param v The value to encode.
+  //! \param out The output buffer, moved past the encoded value.
+  static void encode(uint64_t v, uint8_t *&out) {
+    for (; v >= 0x80; v >>= 7) *out++ = uint8_t(v) | 0x80;
+    *out++ = uint8_t(v);
+  }
+
+  //! Decode a value.
+  //! \param in The input buffer, moved past the decoded value.
+  //! \return the decoded value.
+  static uint64_t decode(const uint8_t *&in) {
+    uint64_t v = *in & 0x7f;
+    for (unsigned shift = 7; *in++ & 0x80; shift += 7)
+      v |= uint64_t(*in & 0x7f) << shift;
+    return v;
+  }
+
+  //! Map a signed value to an unsigned one (0, -1, 1, -2, ...).
+  static uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ (v >> 63); }
+  //! Inverse of zigzag().
+  static int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+};
+
+//! \brief A weighted graph with compressed neighbor lists.
+//!
+//! Every neighbor list is stored in a byte stream as its length followed by
+//! the sorted neighbors, delta-encoded as varints: the first one relative to
+//! the vertex owning the list, the others relative to their predecessor.
+//! Weights live in a separate stream, where a neighborhood whose weights are
+//! all equal (e.g., 1/in-degree or constant weights) stores a single value.
+//! Neighborhoods are decoded on the fly while they are visited, so the graph
+//! is a drop-in replacement of Graph for the traversals of the sampling
+//! algorithms.
+//!
+//! \tparam VertexTy The integer type representing a vertex of the graph.
+//! \tparam WeightTy The type of the weights on the edges.
+//! \tparam DirectionPolicy The policy encoding the graph direction with repect
+//!    of the original data.
+template <typename VertexTy, typename WeightTy = float,
+          typename DirectionPolicy = ForwardDirection<VertexTy>>
+class CompressedGraph {
+ public:
+  //! The size type.
+  using size_type = size_t;
+  //! The type of an edge in the graph.
+  using edge_type = WeightedDestination<VertexTy, WeightTy>;
+  //! The integer type representing vertices in the graph.
+  using vertex_type = VertexTy;
+
+  //! \brief Iterator decoding a neighbor list.
+  class NeighborIterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = edge_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const edge_type *;
+    using reference = edge_type;
+
+    NeighborIterator(const uint8_t *bytes, const WeightTy *weights,
+                     size_t weightStride, size_t remaining, VertexTy owner)
+        : bytes_(bytes),
+          weights_(weights),
+          weightStride_(weightStride),
+          remaining_(remaining),
+          vertex_(owner) {
+      if (remaining_ != 0)
+        vertex_ = int64_t(owner) + varint::unzigzag(varint::decode(bytes_));
+    }
+
+    edge_type operator*() const { return edge_type(vertex_, *weights_); }
+
+    NeighborIterator &operator++() {
+      weights_ += weightStride_;
+      if (--remaining_ != 0) vertex_ += varint::decode(bytes_);
+      return *this;
+    }
+
+    NeighborIterator operator++(int) {
+      NeighborIterator tmp(*this);
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const NeighborIterator &O) const {
+      return remaining_ == O.remaining_;
+    }
+    bool operator!=(const NeighborIterator &O) const { return !(*this == O); }
+
+   private:
+    const uint8_t *bytes_;
+    const WeightTy *weights_;
+    size_t weightStride_;
+    size_t remaining_;
+    VertexTy vertex_;
+  };
+
+  //! \brief The neighborhood of a vertex.
+  class Neighborhood {
+   public:
+    Neighborhood(NeighborIterator B, NeighborIterator E) : begin_(B), end_(E) {}
+
+    //! Begin of the neighborhood.
+    NeighborIterator begin() const { return begin_; }
+    //! End of the neighborhood.
+    NeighborIterator end() const { return end_; }
+
+   private:
+    NeighborIterator begin_;
+    NeighborIterator end_;
+  };
+
+  //! Empty Graph Constructor.
+  CompressedGraph() : numNodes(0), numEdges(0) {}
+
+  //! \brief Compress a Graph.
+  //!
+  //! \tparam DestinationTy The type of the edges of the input graph.
+  //!
+  //! \param G The graph to be compressed.
+  template <typename DestinationTy>
+  explicit CompressedGraph(
+      const Graph<VertexTy, DestinationTy, DirectionPolicy> &G)
+      : numNodes(G.num_nodes()),
+        numEdges(G.num_edges()),
+        byteIndex(G.num_nodes() + 1, 0),
+        weightIndex(G.num_nodes() + 1, 0),
+        reverseMap(G.num_nodes()) {
+#pragma omp parallel for
+    for (size_t v = 0; v < numNodes; ++v) reverseMap[v] = G.convertID(v);
+    idMap = VertexIDMap<VertexTy>(reverseMap);
+
+    // First pass: measure the encoding of every neighborhood.
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      std::vector<edge_type> neighbors;
+      sorted_neighbors(G, v, neighbors);
+      byteIndex[v + 1] = encoded_size(v, neighbors);
+      weightIndex[v + 1] = weights_size(neighbors);
+    }
+
+    parallel_prefix_sum(byteIndex.begin(), byteIndex.end());
+    parallel_prefix_sum(weightIndex.begin(), weightIndex.end());
+
+    bytes.resize(byteIndex.back());
+    weights.resize(weightIndex.back());
+
+    // Second pass: encode.
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      std::vector<edge_type> neighbors;
+      sorted_neighbors(G, v, neighbors);
+
+      uint8_t *out = bytes.data() + byteIndex[v];
+      varint::encode(neighbors.size(), out);
+      int64_t previous = v;
+      for (size_t i = 0; i < neighbors.size(); ++i) {
+        int64_t u = neighbors[i].vertex;
+        varint::encode(i == 0 ? varint::zigzag(u - previous) : u - previous,
+                       out);
+        previous = u;
+      }
+
+      WeightTy *w = weights.data() + weightIndex[v];
+      for (size_t i = 0; i < weightIndex[v + 1] - weightIndex[v]; ++i)
+        w[i] = neighbors[i].weight;
+    }
+  }
+
+  //! Returns the out-degree of a vertex.
+  //! \param v The input vertex.
+  //! \return the out-degree of vertex v in input.
+  size_t degree(VertexTy v) const {
+    const uint8_t *in = bytes.data() + byteIndex[v];
+    return varint::decode(in);
+  }
+
+  //! Returns the neighborhood of a vertex.
+  //! \param v The input vertex.
+  //! \return a range decoding the out-neighbors of the vertex v in input.
+  Neighborhood neighbors(VertexTy v) const {
+    const uint8_t *in = bytes.data() + byteIndex[v];
+    size_t degree = varint::decode(in);
+    const WeightTy *w = weights.data() + weightIndex[v];
+    size_t stride = weightIndex[v + 1] - weightIndex[v] == degree ? 1 : 0;
+    return Neighborhood(NeighborIterator(in, w, stride, degree, v),
+                        NeighborIterator(in, w, stride, 0, v));
+  }
+
+  //! The number of nodes in the Graph.
+  size_t num_nodes() const { return numNodes; }
+
+  //! The number of edges in the Graph.
+  size_t num_edges() const { return numEdges; }
+
+  //! The number of bytes used by the neighbor lists and the weights.
+  size_t memory_footprint() const {
+    return bytes.size() + weights.size() * sizeof(WeightTy) +
+           (byteIndex.size() + weightIndex.size()) * sizeof(uint64_t);
+  }
+
+  //! Convert a list of vertices from the interal representation to the original
+  //! input representation.
+  //!
+  //! \tparam Itr The iterator type of the input sequence of vertex IDs.
+  //! \tparam OutputItr The iterator type of the output sequence.
+  //!
+  //! \param b The begin of the input vertex IDs sequence.
+  //! \param e The end of the input vertex IDs sequence.
+  //! \param o The start of the output vertex IDs sequence.
+  template <typename Itr, typename OutputItr>
+  void convertID(Itr b, Itr e, OutputItr o) const {
+    using value_type = typename Itr::value_type;
+    std::transform(b, e, o, [&](const value_type &v) -> value_type {
+      return reverseMap.at(v);
+    });
+  }
+
+  //! Convert a vertex from the interal representation to the original input
+  //! representation.
+  //!
+  //! \param v The input vertex ID.
+  //! \return The original vertex ID in the input representation.
+  vertex_type convertID(const vertex_type v) const { return reverseMap.at(v); }
+
+  //! Convert a vertex from the original input representation to the internal
+  //! representation.
+  //!
+  //! \param v The original vertex ID.
+  //! \return The internal vertex ID.
+  vertex_type transformID(const vertex_type v) const {
+    vertex_type id;
+    if (idMap.find(v, id))
+      return id;
+    else
+      throw "Bad node";
+  }
+
+ private:
+  template <typename GraphTy>
+  static void sorted_neighbors(const GraphTy &G, size_t v,
+                               std::vector<edge_type> &out) {
+    for (auto u : G.neighbors(v)) out.emplace_back(u.vertex, u.weight);
+    if (!std::is_sorted(out.begin(), out.end()))
+      std::sort(out.begin(), out.end());
+  }
+
+  static size_t encoded_size(size_t v, const std::vector<edge_type> &N) {
+    size_t size = varint::size(N.size());
+    int64_t previous = v;
+    for (size_t i = 0; i < N.size(); ++i) {
+      int64_t u = N[i].vertex;
+      size += varint::size(i == 0 ? varint::zigzag(u - previous) : u - previous);
+      previous = u;
+    }
+    return size;
+  }
+
+  static size_t weights_size(const std::vector<edge_type> &N) {
+    if (N.empty()) return 0;
+    bool uniform = std::all_of(N.begin(), N.end(), [&](const edge_type &e) {
+      return e.weight == N.front().weight;
+    });
+    return uniform ? 1 : N.size();
+  }
+
+  size_t numNodes;
+  size_t numEdges;
+
+  std::vector<uint64_t> byteIndex;
+  std::vector<uint64_t> weightIndex;
+  std::vector<uint8_t> bytes;
+  std::vector<WeightTy> weights;
+
+  VertexIDMap<VertexTy> idMap;
+  std::vector<VertexTy> reverseMap;
+};
+
+}  // namespace ripples
+
+#endif  // RIPPLES_COMPRESSED_GRAPH_H
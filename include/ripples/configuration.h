@@ -59,6 +59,7 @@ struct GraphInputConfiguration {
   bool undirected{false};           //!< is Graph undirected?
   bool disable_renumbering{false};  //!< trust the input to be clean.
   bool reload{false};               //!< are we reloading a binary dump?
+  std::string reordering{"none"};   //!< vertex reordering strategy.
   std::string distribution{"uniform"};
   float mean{0.5};          //!< mean of the normal distribution
   float variance{1.0};      //!< variance of the normal distribution
@@ -93,6 +94,9 @@ struct GraphInputConfiguration {
     app.add_flag("--disable-renumbering", disable_renumbering,
                  "Load the graph as is from the input.")
         ->group("Input Options");
+    app.add_option("--reorder", reordering,
+                   "Relabel the vertices for locality (none|degree|rcm|gorder)")
+        ->group("Input Options");
   }
 };
 
@@ -0,0 +1,113 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_COUNT_STATISTICS_H
+#define RIPPLES_COUNT_STATISTICS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+
+namespace ripples {
+
+//! \brief The distribution statistics of the vertex occurrence counters.
+//!
+//! The statistics are accumulated as power sums, so that they can be
+//! gathered in the same pass as the reduction of the counters and merged
+//! across threads.  They decide whether a block of RRR sets is worth
+//! Huffman-encoding.
+struct CountStatistics {
+  size_t num_vertices{0};
+  double sum{0};     //!< The sum of the counts.
+  double sum2{0};    //!< The sum of the squared counts.
+  double sum3{0};    //!< The sum of the cubed counts.
+  double sum4{0};    //!< The sum of the counts to the fourth.
+  double sum_xlogx{0};  //!< The sum of x log2(x) over the non-zero counts.
+
+  //! Account for the count of a vertex.
+  void add(uint32_t count) {
+    double x = count;
+    double x2 = x * x;
+    ++num_vertices;
+    sum += x;
+    sum2 += x2;
+    sum3 += x2 * x;
+    sum4 += x2 * x2;
+    if (count != 0) sum_xlogx += x * std::log2(x);
+  }
+
+  //! Merge the statistics of another range of vertices.
+  CountStatistics &operator+=(const CountStatistics &O) {
+    num_vertices += O.num_vertices;
+    sum += O.sum;
+    sum2 += O.sum2;
+    sum3 += O.sum3;
+    sum4 += O.sum4;
+    sum_xlogx += O.sum_xlogx;
+    return *this;
+  }
+
+  //! \brief The entropy, skewness, kurtosis and density of the counts.
+  //!
+  //! \param delta_block The number of RRR sets counted.
+  //! \return the tuple (entropy, skewness, excess kurtosis, density).
+  std::tuple<float, float, float, double> summary(size_t delta_block) const {
+    double N = num_vertices;
+    double density = sum / (N * delta_block);
+    double entropy = sum > 0 ? std::log2(sum) - sum_xlogx / sum : 0;
+
+    double mean = sum / N;
+    double s2 = (sum2 - N * mean * mean) / (N - 1);
+    double s = std::sqrt(s2);
+    double m3 = sum3 / N - 3 * mean * sum2 / N + 2 * mean * mean * mean;
+    double m4 = sum4 / N - 4 * mean * sum3 / N + 6 * mean * mean * sum2 / N -
+                3 * mean * mean * mean * mean;
+    double skew = m3 / (s2 * s);
+    double kurt = m4 / (s2 * s2) - 3;
+    return std::make_tuple(float(entropy), float(skew), float(kurt), density);
+  }
+};
+
+}  // namespace ripples
+
+#endif /* RIPPLES_COUNT_STATISTICS_H */
@@ -0,0 +1,242 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_COUNTER_RNG_H
+#define RIPPLES_COUNTER_RNG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace ripples {
+
+//! \brief The Philox4x32-10 counter-based random number generator.
+//!
+//! Philox (Salmon et al., SC'11) turns a 128-bit counter into four random
+//! 32-bit words with ten rounds of a keyed bijection, so any position of any
+//! stream can be reached in constant time.  The key is the seed and the
+//! counter is laid out as (block, stream, sample index):
+//!
+//!  - split() selects a stream, as trng::lcg64::split does for the workers;
+//!  - seek_sample() positions the generator at the start of the numbers of
+//!    an RRR set, so that the set only depends on the seed and on its index.
+//!
+//! Blocks are produced kBlocks at a time in structure-of-arrays form, which
+//! compilers turn into SIMD multiplies, and buffered for operator().
+class Philox4x32 {
+ public:
+  using result_type = uint32_t;
+
+  //! The number of blocks of four words generated together.
+  static constexpr size_t kBlocks = 4;
+  //! The number of words generated together.
+  static constexpr size_t kWords = 4 * kBlocks;
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  //! \param s The seed of the generator.
+  explicit Philox4x32(uint64_t s = 0) { seed(s); }
+
+  //! Reset the generator to the first stream of a seed.
+  //! \param s The seed.
+  void seed(uint64_t s) {
+    key_[0] = uint32_t(s);
+    key_[1] = uint32_t(s >> 32);
+    block_ = stream_ = 0;
+    sample_ = 0;
+    position_ = kWords;
+  }
+
+  //! \brief Select the rank-th of num streams of the current stream.
+  //!
+  //! Nested splits compose like digits of a mixed-radix number.  The stream
+  //! identifier has 32 bits.
+  void split(size_t num, size_t rank) {
+    stream_ = uint32_t(stream_ * num + rank);
+    block_ = 0;
+    position_ = kWords;
+  }
+
+  //! Move to the start of the numbers of the sample of the given index.
+  //! \param index The index of the sample.
+  void seek_sample(uint64_t index) {
+    sample_ = index;
+    block_ = 0;
+    position_ = kWords;
+  }
+
+  //! The next 32 random bits.
+  result_type operator()() {
+    if (position_ == kWords) {
+      generate(block_, words_);
+      block_ += kBlocks;
+      position_ = 0;
+    }
+    return words_[position_++];
+  }
+
+  //! Skip the next n numbers.
+  void discard(uint64_t n) {
+    uint64_t buffered = kWords - position_;
+    if (n <= buffered) {
+      position_ += n;
+      return;
+    }
+    n -= buffered;
+    uint64_t start = block_ * 4 + n;
+    block_ = uint32_t(start / kWords) * kBlocks;
+    position_ = kWords;
+    if (start % kWords == 0) return;
+    generate(block_, words_);
+    block_ += kBlocks;
+    position_ = start % kWords;
+  }
+
+  //! \brief Fill a buffer with the next n random 32-bit words.
+  //!
+  //! The result is the same sequence that n calls to operator() return.
+  //!
+  //! \param out The output buffer.
+  //! \param n The number of words.
+  void fill(uint32_t *out, size_t n) {
+    while (n != 0 && position_ != kWords) {
+      *out++ = words_[position_++];
+      --n;
+    }
+    for (; n >= kWords; n -= kWords, out += kWords) {
+      generate(block_, out);
+      block_ += kBlocks;
+    }
+    for (; n != 0; --n) *out++ = (*this)();
+  }
+
+ private:
+  //! Generate the kBlocks blocks starting at the given block counter.
+  void generate(uint32_t first_block, uint32_t *out) const {
+    uint32_t c0[kBlocks], c1[kBlocks], c2[kBlocks], c3[kBlocks];
+    for (size_t b = 0; b < kBlocks; ++b) {
+      c0[b] = first_block + uint32_t(b);
+      c1[b] = stream_;
+      c2[b] = uint32_t(sample_);
+      c3[b] = uint32_t(sample_ >> 32);
+    }
+
+    uint32_t k0 = key_[0], k1 = key_[1];
+    for (int round = 0; round < 10; ++round) {
+      for (size_t b = 0; b < kBlocks; ++b) {
+        uint64_t p0 = uint64_t(0xD2511F53) * c0[b];
+        uint64_t p1 = uint64_t(0xCD9E8D57) * c2[b];
+        uint32_t n0 = uint32_t(p1 >> 32) ^ c1[b] ^ k0;
+        uint32_t n2 = uint32_t(p0 >> 32) ^ c3[b] ^ k1;
+        c1[b] = uint32_t(p1);
+        c3[b] = uint32_t(p0);
+        c0[b] = n0;
+        c2[b] = n2;
+      }
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+
+    for (size_t b = 0; b < kBlocks; ++b) {
+      out[4 * b] = c0[b];
+      out[4 * b + 1] = c1[b];
+      out[4 * b + 2] = c2[b];
+      out[4 * b + 3] = c3[b];
+    }
+  }
+
+  uint32_t key_[2];
+  uint32_t block_;
+  uint32_t stream_;
+  uint64_t sample_;
+  size_t position_;
+  uint32_t words_[kWords];
+};
+
+//! Does a generator derive the numbers of a sample from its index?
+template <typename PRNGeneratorTy>
+struct is_counter_based_rng : std::false_type {};
+
+template <>
+struct is_counter_based_rng<Philox4x32> : std::true_type {};
+
+//! \brief Give a walk worker its own stream of a generator.
+//!
+//! Counter-based generators are not split: the workers position them at the
+//! index of every sample they draw, so the samples do not depend on the
+//! number of workers or on how the work is distributed among them.
+//!
+//! \param generator The generator of the worker.
+//! \param num The number of workers.
+//! \param rank The rank of the worker.
+template <typename PRNGeneratorTy>
+void split_worker_rng(PRNGeneratorTy &generator, size_t num, size_t rank) {
+  if (!is_counter_based_rng<PRNGeneratorTy>::value) generator.split(num, rank);
+}
+
+//! Position a counter-based generator at the numbers of a sample.
+template <typename PRNGeneratorTy>
+void seek_sample(PRNGeneratorTy &generator, uint64_t index, std::true_type) {
+  generator.seek_sample(index);
+}
+
+//! Other generators simply go on with their stream.
+template <typename PRNGeneratorTy>
+void seek_sample(PRNGeneratorTy &, uint64_t, std::false_type) {}
+
+//! \brief Position a generator at the numbers of a sample, if it is counter
+//! based.
+//!
+//! \param generator The generator.
+//! \param index The index of the sample.
+template <typename PRNGeneratorTy>
+void seek_sample(PRNGeneratorTy &generator, uint64_t index) {
+  seek_sample(generator, index, is_counter_based_rng<PRNGeneratorTy>());
+}
+
+}  // namespace ripples
+
+#endif /* RIPPLES_COUNTER_RNG_H */
@@ -44,6 +44,7 @@
 #define RIPPLES_COUNTING_H
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 
 #include <omp.h>
@@ -52,6 +53,15 @@
 
 namespace ripples {
 
+//! \brief The number of samples an RRR set stands for when counting coverage.
+//!
+//! Plain RRR sets are one sample.  Storages folding identical samples, as
+//! WeightedRRRsets does, overload this to weight their entries.
+template <typename RRRsetTy>
+constexpr uint32_t rrr_set_multiplicity(const RRRsetTy &) {
+  return 1;
+}
+
 //! \brief Count the occurrencies of vertices in the RRR sets.
 //!
 //! \tparam InItr The input sequence iterator type.
@@ -68,8 +78,9 @@ void CountOccurrencies(InItr in_begin, InItr in_end, OutItr out_begin,
   using rrr_set_type = typename std::iterator_traits<InItr>::value_type;
   using vertex_type = typename rrr_set_type::value_type;
   for (; in_begin != in_end; ++in_begin) {
+    uint32_t weight = rrr_set_multiplicity(*in_begin);
     std::for_each(in_begin->begin(), in_begin->end(),
-                  [&](const vertex_type v) { *(out_begin + v) += 1; });
+                  [&](const vertex_type v) { *(out_begin + v) += weight; });
   }
 }
 
@@ -103,8 +114,9 @@ void CountOccurrencies(InItr in_begin, InItr in_end, OutItr out_begin,
       auto t1 = std::chrono::high_resolution_clock::now();
       auto end = std::upper_bound(begin, itr->end(), high - 1);
       auto t2 = std::chrono::high_resolution_clock::now();
+      uint32_t weight = rrr_set_multiplicity(*itr);
       std::for_each(begin, end,
-                    [&](const vertex_type v) { *(out_begin + v) += 1; workload[threadnum]+=1; });
+                    [&](const vertex_type v) { *(out_begin + v) += weight; workload[threadnum]+=1; });
       auto t3 = std::chrono::high_resolution_clock::now();
       tLs[threadnum]+=t1-t0;
       tUs[threadnum]+=t2-t1;
@@ -298,8 +310,9 @@ template <typename RRRsetsItrTy, typename VertexCoverageVectorTy>
 void UpdateCounters(RRRsetsItrTy B, RRRsetsItrTy E,
                     VertexCoverageVectorTy &vertexCoverage, sequential_tag &&) {
   for (; B != E; ++B) {
+    uint32_t weight = rrr_set_multiplicity(*B);
     for (auto v : *B) {
-      vertexCoverage[v] -= 1;
+      vertexCoverage[v] -= weight;
     }
   }
 }
@@ -310,9 +323,10 @@ void UpdateCounters(RRRsetsItrTy B, RRRsetsItrTy E,
                     VertexCoverageVectorTy &vertexCoverage,
                     size_t num_threads) {
   for (; B != E; ++B) {
+    uint32_t weight = rrr_set_multiplicity(*B);
 #pragma omp parallel for num_threads(num_threads)
     for (size_t j = 0; j < (*B).size(); ++j) {
-      vertexCoverage[(*B)[j]] -= 1;
+      vertexCoverage[(*B)[j]] -= weight;
     }
   }
 }
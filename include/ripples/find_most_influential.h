@@ -53,9 +53,11 @@
 #include "ripples/counting.h"
 #include "ripples/imm_execution_record.h"
 #include "ripples/partition.h"
+#include "ripples/rrr_store.h"
 #include "ripples/streaming_find_most_influential.h"
 #include "ripples/utility.h"
 #include "ripples/huffman.h"
+#include "ripples/weighted_rrr_sets.h"
 
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
@@ -188,10 +190,136 @@ auto FindMostInfluentialSet(const GraphTy &G, const ConfTy &CFG,
   }
 #endif
 
-  StreamingFindMostInfluential<GraphTy> SE(G, RRRsets, num_max_cpu, num_gpu);
+  StreamingFindMostInfluential<GraphTy, std::vector<RRRset>> SE(
+      G, RRRsets, num_max_cpu, num_gpu);
   return SE.find_most_influential_set(CFG.k);
 }
 
+//! \brief Select k seeds from the RRR sets of an RRRStore.
+//!
+//! The selection partitions the index of the store, leaving the arenas
+//! untouched.
+template <typename GraphTy, typename ConfTy, typename VertexTy,
+          typename AllocatorTy, typename execution_tag>
+auto FindMostInfluentialSet(const GraphTy &G, const ConfTy &CFG,
+                            RRRStore<VertexTy, AllocatorTy> &RRRsets,
+                            IMMExecutionRecord &record, bool enableGPU,
+                            execution_tag &&ex_tag) {
+  return FindMostInfluentialSet(G, CFG, RRRsets.sets(), record, enableGPU,
+                                std::forward<execution_tag>(ex_tag));
+}
+
+//! \brief Select k seeds from multiplicity-aware RRR sets.
+//!
+//! The greedy selection of the sequential overload with every entry weighted
+//! by its multiplicity.  Singletons only contribute to the coverage of their
+//! root, so they seed the counters and never take part in the partitioning.
+//!
+//! \tparam GraphTy The graph type.
+//! \tparam ConfTy The configuration type.
+//! \tparam RRRsetTy The type storing the vertices of the RRR sets.
+//! \tparam execution_tag The execution policy.
+//!
+//! \param G The input graph.
+//! \param CFG The configuration.
+//! \param RRRsets The deduplicated Random Reverse Reachability sets.
+//! \param record Data structure storing timing and event counts.
+//! \param enableGPU Ignored: the weighted selection runs on the CPU.
+//! \param ex_tag The execution policy tag.
+//!
+//! \return a pair where the double is the fraction of RRR sets covered and
+//! the set of vertices selected as seeds.
+template <typename GraphTy, typename ConfTy, typename RRRsetTy,
+          typename execution_tag>
+auto FindMostInfluentialSet(const GraphTy &G, const ConfTy &CFG,
+                            WeightedRRRsets<RRRsetTy> &RRRsets,
+                            IMMExecutionRecord &record, bool enableGPU,
+                            execution_tag &&ex_tag) {
+  using vertex_type = typename GraphTy::vertex_type;
+  using weighted_rrr_set = typename WeightedRRRsets<RRRsetTy>::value_type;
+  size_t k = CFG.k;
+
+  auto &sets = RRRsets.sets();
+  const auto &singletons = RRRsets.singletons();
+  std::vector<uint32_t> vertexCoverage(singletons);
+
+  auto cmp = [](std::pair<vertex_type, size_t> &a,
+                std::pair<vertex_type, size_t> &b) {
+    return a.second < b.second;
+  };
+  using priorityQueue =
+      std::priority_queue<std::pair<vertex_type, size_t>,
+                          std::vector<std::pair<vertex_type, size_t>>,
+                          decltype(cmp)>;
+
+  std::vector<std::pair<vertex_type, size_t>> queue_storage(G.num_nodes());
+
+  auto counting = measure<>::exec_time([&]() {
+    CountOccurrencies(sets.begin(), sets.end(), vertexCoverage.begin(),
+                      vertexCoverage.end(),
+                      std::forward<execution_tag>(ex_tag));
+  });
+
+  InitHeapStorage(vertexCoverage.begin(), vertexCoverage.end(),
+                  queue_storage.begin(), queue_storage.end(),
+                  std::forward<execution_tag>(ex_tag));
+
+  priorityQueue queue(cmp, std::move(queue_storage));
+
+  std::vector<vertex_type> result;
+  result.reserve(k);
+
+  size_t uncovered = RRRsets.size();
+
+  auto end = sets.end();
+  typename IMMExecutionRecord::ex_time_ms pivoting;
+
+  while (result.size() < k && uncovered != 0) {
+    auto element = queue.top();
+    queue.pop();
+
+    if (element.second > vertexCoverage[element.first]) {
+      element.second = vertexCoverage[element.first];
+      queue.push(element);
+      continue;
+    }
+
+    uncovered -= element.second;
+
+    auto cmp = [=](const weighted_rrr_set &a) -> auto {
+      return !std::binary_search(a.begin(), a.end(), element.first);
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto itr = partition(sets.begin(), end, cmp,
+                         std::forward<execution_tag>(ex_tag));
+    pivoting += (std::chrono::high_resolution_clock::now() - start);
+
+    counting += measure<>::exec_time([&]() {
+      if (std::distance(itr, end) < std::distance(sets.begin(), itr)) {
+        UpdateCounters(itr, end, vertexCoverage,
+                       std::forward<execution_tag>(ex_tag));
+      } else {
+        std::copy(singletons.begin(), singletons.end(),
+                  vertexCoverage.begin());
+        CountOccurrencies(sets.begin(), itr, vertexCoverage.begin(),
+                          vertexCoverage.end(),
+                          std::forward<execution_tag>(ex_tag));
+      }
+    });
+    end = itr;
+    result.push_back(element.first);
+  }
+
+  double f = double(RRRsets.size() - uncovered) / RRRsets.size();
+
+  record.Counting.push_back(
+      std::chrono::duration_cast<typename IMMExecutionRecord::ex_time_ms>(
+          counting));
+  record.Pivoting.push_back(pivoting);
+  return std::make_pair(f, result);
+}
+
 #if RIPPLES_ENABLE_CUDA
 template <typename Itr>
 void MoveRRRSets(Itr in_begin, Itr in_end, uint32_t *d_rrr_index,
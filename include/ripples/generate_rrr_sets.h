@@ -44,15 +44,28 @@
 #define RIPPLES_GENERATE_RRR_SETS_H
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <queue>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <iostream>
 #include "omp.h"
 
+#include "ripples/count_statistics.h"
 #include "ripples/diffusion_simulation.h"
 #include "ripples/graph.h"
 #include "ripples/imm_execution_record.h"
+#include "ripples/live_edge_world.h"
+#include "ripples/rrr_sort.h"
+#include "ripples/rrr_store.h"
+#include "ripples/sampling_scratch.h"
+#include "ripples/small_rrr_set.h"
 #include "ripples/utility.h"
 #include "ripples/streaming_rrr_generator.h"
 #include "ripples/huffman.h"
@@ -75,10 +88,19 @@ using RRRsetAllocator = std::allocator<vertex_type>;
 #endif
 
 //! \brief The Random Reverse Reachability Sets type
+//!
+//! Small sets, the common case for LT walks and sparse IC, are stored inline;
+//! larger ones spill to the heap through RRRsetAllocator.
 template <typename GraphTy>
-using RRRset = std::vector<typename GraphTy::vertex_type, RRRsetAllocator<typename GraphTy::vertex_type>>;
+using RRRset = SmallRRRset<typename GraphTy::vertex_type,
+                           RRRsetAllocator<typename GraphTy::vertex_type>>;
 template <typename GraphTy>
 using RRRsets = std::vector<RRRset<GraphTy>>;
+//! \brief The arena storage of Random Reverse Reachability Sets.
+template <typename GraphTy>
+using RRRsetStore =
+    RRRStore<typename GraphTy::vertex_type,
+             RRRsetAllocator<typename GraphTy::vertex_type>>;
 
 //! \brief Execute a randomize BFS to generate a Random RR Set.
 //!
@@ -153,6 +175,254 @@ void ReadRRRSets(const GraphTy &G) {
   // return tmp_A;
 }
 
+namespace {
+
+//! The number of random bits in the raw output of a generator, 0 when the
+//! output does not span a full 32- or 64-bit word.
+template <typename PRNGeneratorTy>
+using random_word_bits = std::integral_constant<
+    int, PRNGeneratorTy::min() != 0 ? 0
+         : PRNGeneratorTy::max() == std::numeric_limits<uint64_t>::max() ? 64
+         : PRNGeneratorTy::max() == std::numeric_limits<uint32_t>::max() ? 32
+                                                                         : 0>;
+
+//! 32 random bits from a generator producing 64 random bits.
+template <typename PRNGeneratorTy>
+uint32_t random_bits32(PRNGeneratorTy &generator,
+                       std::integral_constant<int, 64>) {
+  return uint32_t(generator() >> 32);
+}
+
+//! 32 random bits from a generator producing 32 random bits.
+template <typename PRNGeneratorTy>
+uint32_t random_bits32(PRNGeneratorTy &generator,
+                       std::integral_constant<int, 32>) {
+  return uint32_t(generator());
+}
+
+//! 32 random bits from any other generator.
+template <typename PRNGeneratorTy>
+uint32_t random_bits32(PRNGeneratorTy &generator,
+                       std::integral_constant<int, 0>) {
+  trng::uniform01_dist<double> value;
+  return uint32_t(value(generator) * 4294967296.0);
+}
+
+//! 32 random bits, taken from the raw generator output when possible.
+template <typename PRNGeneratorTy>
+uint32_t random_bits32(PRNGeneratorTy &generator) {
+  return random_bits32(generator, random_word_bits<PRNGeneratorTy>());
+}
+
+//! Is an edge live under the IC model?
+template <typename VertexTy, typename WeightTy, typename PRNGeneratorTy>
+bool is_live_edge(const WeightedDestination<VertexTy, WeightTy> &u,
+                  PRNGeneratorTy &generator,
+                  trng::uniform01_dist<float> &value) {
+  return value(generator) <= u.weight;
+}
+
+template <typename VertexTy, typename PRNGeneratorTy>
+bool is_live_edge(const ThresholdDestination<VertexTy> &u,
+                  PRNGeneratorTy &generator, trng::uniform01_dist<float> &) {
+  return random_bits32(generator) < u.threshold;
+}
+
+//! The probability of an edge under the IC model.
+template <typename VertexTy, typename WeightTy>
+double edge_probability(const WeightedDestination<VertexTy, WeightTy> &u) {
+  return u.weight;
+}
+
+template <typename VertexTy>
+double edge_probability(const ThresholdDestination<VertexTy> &u) {
+  return u.threshold * (1.0 / 4294967296.0);
+}
+
+//! Above this probability most edges are live and flipping them is cheaper.
+constexpr double geometric_skip_max_probability = 0.25;
+
+//! The equal-weight runs of the in-edges of a vertex, when the graph carries
+//! the run index (see Graph::build_ic_runs), and none otherwise.
+template <typename GraphTy>
+auto ic_runs(const GraphTy &G, typename GraphTy::vertex_type v, int)
+    -> decltype(G.ic_runs(v)) {
+  if (G.has_ic_runs()) return G.ic_runs(v);
+  return {nullptr, nullptr};
+}
+
+template <typename GraphTy>
+std::pair<const EdgeRun *, const EdgeRun *> ic_runs(
+    const GraphTy &, typename GraphTy::vertex_type, long) {
+  return {nullptr, nullptr};
+}
+
+//! \brief Visit the live in-neighbors of a vertex under the IC model.
+//!
+//! Within a recorded run of unlikely edges of probability p, the distance to
+//! the next live edge is drawn from the geometric distribution of parameter
+//! p and the sampler jumps there with index arithmetic, so that the random
+//! draws, the visited probes and the edges read are proportional to the
+//! number of live edges of the run rather than to its length.  The other
+//! edges, and all the edges of graphs without the run index, are flipped
+//! one by one, skipping the already visited neighbors.
+//!
+//! \param G The graph.
+//! \param v The vertex.
+//! \param generator The random number generator.
+//! \param value The distribution used for floating point weights.
+//! \param visited The vertices already in the RRR set.
+//! \param visit The function called on the unvisited live in-neighbors.
+template <typename GraphTy, typename PRNGeneratorTy, typename VisitedTy,
+          typename VisitFn>
+void for_each_live_in_neighbor(const GraphTy &G,
+                               typename GraphTy::vertex_type v,
+                               PRNGeneratorTy &generator,
+                               trng::uniform01_dist<float> &value,
+                               const VisitedTy &visited,
+                               VisitFn &&visit) {
+  trng::uniform01_dist<double> skip_value;
+  auto begin = G.neighbors(v).begin();
+  auto flip = [&](size_t from, size_t to) {
+    for (auto itr = std::next(begin, from); from != to; ++from, ++itr) {
+      auto u = *itr;
+      if (!visited[u.vertex] && is_live_edge(u, generator, value))
+        visit(u.vertex);
+    }
+  };
+
+  size_t position = 0;
+  auto runs = ic_runs(G, v, 0);
+  for (auto run = runs.first; run != runs.second; ++run) {
+    flip(position, run->begin);
+    position = run->end;
+
+    auto run_begin = std::next(begin, run->begin);
+    double p = edge_probability(*run_begin);
+    if (p > geometric_skip_max_probability) {
+      flip(run->begin, run->end);
+      continue;
+    }
+    if (p <= 0) continue;
+
+    double log_q = std::log1p(-p);
+    size_t length = run->end - run->begin;
+    size_t offset = 0;
+    while (true) {
+      double skip = std::floor(std::log(1.0 - skip_value(generator)) / log_q);
+      if (skip >= double(length - offset)) break;
+      offset += size_t(skip);
+      auto u = *std::next(run_begin, offset);
+      if (!visited[u.vertex]) visit(u.vertex);
+      if (++offset == length) break;
+    }
+  }
+  flip(position, G.degree(v));
+}
+
+//! Pick the live in-edge of a vertex under the LT model.
+template <typename GraphTy, typename PRNGeneratorTy>
+bool live_in_neighbor(const GraphTy &G, typename GraphTy::vertex_type v,
+                      PRNGeneratorTy &generator,
+                      trng::uniform01_dist<float> &value,
+                      typename GraphTy::vertex_type &picked, std::false_type) {
+  float threshold = value(generator);
+  for (auto u : G.neighbors(v)) {
+    threshold -= u.weight;
+
+    if (threshold > 0) continue;
+
+    picked = u.vertex;
+    return true;
+  }
+  return false;
+}
+
+template <typename GraphTy, typename PRNGeneratorTy>
+bool live_in_neighbor(const GraphTy &G, typename GraphTy::vertex_type v,
+                      PRNGeneratorTy &generator, trng::uniform01_dist<float> &,
+                      typename GraphTy::vertex_type &picked, std::true_type) {
+  uint32_t threshold = random_bits32(generator);
+  for (auto u : G.neighbors(v)) {
+    if (threshold < u.threshold) {
+      picked = u.vertex;
+      return true;
+    }
+    threshold -= u.threshold;
+  }
+  return false;
+}
+
+//! Pick the live in-edge with a binary search on the cumulative weights,
+//! when the graph carries a linear threshold index.
+template <typename GraphTy, typename PRNGeneratorTy>
+auto live_in_neighbor(const GraphTy &G, typename GraphTy::vertex_type v,
+                      PRNGeneratorTy &generator,
+                      trng::uniform01_dist<float> &value,
+                      typename GraphTy::vertex_type &picked, int)
+    -> decltype(G.has_lt_index(), bool()) {
+  if (!G.has_lt_index())
+    return live_in_neighbor(
+        G, v, generator, value, picked,
+        is_threshold_destination<typename GraphTy::edge_type>());
+
+  // The first neighbor whose cumulative weight reaches the threshold is the
+  // one where the linear scan would have stopped, up to float rounding: the
+  // scan subtracts the weights from the threshold while the index adds them
+  // up, so a threshold within an ulp of a prefix sum may pick the next edge.
+  float threshold = value(generator);
+  auto begin = G.lt_index(v);
+  auto end = begin + G.degree(v);
+  auto itr = std::lower_bound(begin, end, threshold);
+  if (itr == end) return false;
+
+  picked = G.neighbors(v).begin()[itr - begin].vertex;
+  return true;
+}
+
+template <typename GraphTy, typename PRNGeneratorTy>
+bool live_in_neighbor(const GraphTy &G, typename GraphTy::vertex_type v,
+                      PRNGeneratorTy &generator,
+                      trng::uniform01_dist<float> &value,
+                      typename GraphTy::vertex_type &picked, long) {
+  return live_in_neighbor(
+      G, v, generator, value, picked,
+      is_threshold_destination<typename GraphTy::edge_type>());
+}
+
+//! Pick the live in-edge of a vertex under the LT model, if any.
+//!
+//! \param G The graph.
+//! \param v The vertex.
+//! \param generator The random number generator.
+//! \param value The distribution used for floating point weights.
+//! \param picked The source of the live edge, when one is picked.
+//! \return true if an in-edge of v is live.
+template <typename GraphTy, typename PRNGeneratorTy>
+bool live_in_neighbor(const GraphTy &G, typename GraphTy::vertex_type v,
+                      PRNGeneratorTy &generator,
+                      trng::uniform01_dist<float> &value,
+                      typename GraphTy::vertex_type &picked) {
+  return live_in_neighbor(G, v, generator, value, picked, 0);
+}
+
+//! Prefetch the in-edges of a vertex and their cumulative weights, when the
+//! graph carries a linear threshold index.
+template <typename GraphTy>
+auto prefetch_in_edges(const GraphTy &G, typename GraphTy::vertex_type v, int)
+    -> decltype(G.has_lt_index(), void()) {
+  __builtin_prefetch(G.neighbors(v).begin());
+  if (G.has_lt_index()) __builtin_prefetch(G.lt_index(v));
+}
+
+template <typename GraphTy>
+void prefetch_in_edges(const GraphTy &G, typename GraphTy::vertex_type v,
+                       long) {
+  __builtin_prefetch(G.neighbors(v).begin());
+}
+
+}  // namespace
+
 template <typename GraphTy, typename PRNGeneratorTy, typename diff_model_tag>
 void AddRRRSet(const GraphTy &G, typename GraphTy::vertex_type r,
                PRNGeneratorTy &generator, RRRset<GraphTy> &result,
@@ -161,45 +431,39 @@ void AddRRRSet(const GraphTy &G, typename GraphTy::vertex_type r,
 
   trng::uniform01_dist<float> value;
 
-  std::queue<vertex_type> queue;
-  std::vector<bool> visited(G.num_nodes(), false);
+  auto &scratch = thread_sampling_scratch<vertex_type>(G.num_nodes());
+  auto &queue = scratch.queue;
+  auto &visited = scratch.visited;
 
-  queue.push(r);
-  visited[r] = true;
+  queue.push_back(r);
+  visited.insert(r);
   result.push_back(r);
 
   while (!queue.empty()) {
     vertex_type v = queue.front();
-    queue.pop();
+    queue.pop_front();
 
     if (std::is_same<diff_model_tag, ripples::independent_cascade_tag>::value) {
-      for (auto u : G.neighbors(v)) {
-        if (!visited[u.vertex] && value(generator) <= u.weight) {
-          queue.push(u.vertex);
-          visited[u.vertex] = true;
-          result.push_back(u.vertex);
-        }
-      }
+      for_each_live_in_neighbor(G, v, generator, value, visited,
+                                [&](vertex_type u) {
+                                  queue.push_back(u);
+                                  visited.insert(u);
+                                  result.push_back(u);
+                                });
     } else if (std::is_same<diff_model_tag,
                             ripples::linear_threshold_tag>::value) {
-      float threshold = value(generator);
-      for (auto u : G.neighbors(v)) {
-        threshold -= u.weight;
-
-        if (threshold > 0) continue;
-
-        if (!visited[u.vertex]) {
-          queue.push(u.vertex);
-          visited[u.vertex] = true;
-          result.push_back(u.vertex);
-        }
-        break;
+      vertex_type u;
+      if (live_in_neighbor(G, v, generator, value, u) && !visited[u]) {
+        queue.push_back(u);
+        visited.insert(u);
+        result.push_back(u);
       }
     } else {
       throw;
     }
   }
-  std::stable_sort(result.begin(), result.end());
+  SortRRRSet(result.begin(), result.end(), scratch.sort_buffer,
+             [&](vertex_type v) { return visited[v]; });
 }
 
 template <typename GraphTy, typename PRNGeneratorTy, typename diff_model_tag>
@@ -210,46 +474,412 @@ void AddRRRSet2(const GraphTy &G, typename GraphTy::vertex_type r,
 
   trng::uniform01_dist<float> value;
 
-  std::deque<vertex_type> queue;
-  std::vector<bool> visited(G.num_nodes(), false);
-  double vm1,vm2;
+  auto &scratch = thread_sampling_scratch<vertex_type>(G.num_nodes());
+  auto &queue = scratch.queue;
+  auto &visited = scratch.visited;
+
   queue.push_front(r);
-  visited[r] = true;
+  visited.insert(r);
   result.push_back(r);
   while (!queue.empty()) {
     vertex_type v = queue.front();
     queue.pop_front();
 
     if (std::is_same<diff_model_tag, ripples::independent_cascade_tag>::value) {
-      for (auto u : G.neighbors(v)) {
-        if (!visited[u.vertex] && value(generator) <= u.weight) {
-          queue.push_front(u.vertex);
-          visited[u.vertex] = true;
-          result.push_back(u.vertex);
-        }
-      }
+      for_each_live_in_neighbor(G, v, generator, value, visited,
+                                [&](vertex_type u) {
+                                  queue.push_front(u);
+                                  visited.insert(u);
+                                  result.push_back(u);
+                                });
     } else if (std::is_same<diff_model_tag,
                             ripples::linear_threshold_tag>::value) {
-      float threshold = value(generator);
-      for (auto u : G.neighbors(v)) {
-        threshold -= u.weight;
+      vertex_type u;
+      if (live_in_neighbor(G, v, generator, value, u) && !visited[u]) {
+        queue.push_front(u);
+        visited.insert(u);
+        result.push_back(u);
+      }
+    } else {
+      throw;
+    }
+  }
+  SortRRRSet(result.begin(), result.end(), scratch.sort_buffer,
+             [&](vertex_type v) { return visited[v]; });
+}
+
+//! \brief Sample a Random RR Set into an RRRStore.
+//!
+//! The set is built in a per-thread buffer that keeps its capacity across
+//! samples and is then copied into the arena of the store.
+template <typename GraphTy, typename PRNGeneratorTy, typename diff_model_tag,
+          typename AllocatorTy>
+void AddRRRSet(const GraphTy &G, typename GraphTy::vertex_type r,
+               PRNGeneratorTy &generator,
+               RRRStoreSlot<typename GraphTy::vertex_type, AllocatorTy> result,
+               diff_model_tag &&tag) {
+  thread_local RRRset<GraphTy> buffer;
+  buffer.clear();
+  AddRRRSet(G, r, generator, buffer, std::forward<diff_model_tag>(tag));
+  result.assign(buffer.begin(), buffer.end());
+}
+
+template <typename GraphTy, typename PRNGeneratorTy, typename diff_model_tag,
+          typename AllocatorTy>
+void AddRRRSet2(const GraphTy &G, typename GraphTy::vertex_type r,
+                PRNGeneratorTy &generator,
+                RRRStoreSlot<typename GraphTy::vertex_type, AllocatorTy> result,
+                diff_model_tag &&tag) {
+  thread_local RRRset<GraphTy> buffer;
+  buffer.clear();
+  AddRRRSet2(G, r, generator, buffer, std::forward<diff_model_tag>(tag));
+  result.assign(buffer.begin(), buffer.end());
+}
+
+//! \brief Sample up to 64 RRR sets, one traversal per root.
+//!
+//! The default for the diffusion models without a batched kernel.
+//!
+//! \tparam GraphTy The type of the graph.
+//! \tparam PRNGeneratorTy The type of pseudo the random number generator.
+//! \tparam ItrTy The type of the iterator to the output RRR sets.
+//! \tparam diff_model_tag The Type-Tag selecting the diffusion model.
+//!
+//! \param G The graph instance.
+//! \param roots The roots of the samples.
+//! \param count The number of samples, at most bit_parallel_batch_size.
+//! \param generator The pseudo random number generator.
+//! \param first The output RRR sets, one per root.
+//! \param tag The diffusion model tag.
+template <typename GraphTy, typename PRNGeneratorTy, typename ItrTy,
+          typename diff_model_tag>
+void AddRRRSetBatch(const GraphTy &G,
+                    const typename GraphTy::vertex_type *roots, size_t count,
+                    PRNGeneratorTy &generator, ItrTy first,
+                    diff_model_tag &&tag) {
+  for (size_t i = 0; i < count; ++i, ++first)
+    AddRRRSet(G, roots[i], generator, *first,
+              std::forward<diff_model_tag>(tag));
+}
+
+//! \brief Sample a Random RR Set under the IC model, stopping early when its
+//! frontier grows past a bound.
+//!
+//! The traversal is the one of AddRRRSet.  When more than max_frontier
+//! vertices wait to be expanded, the sample is handed over as it is, so that
+//! it can be completed by ExpandRRRFrontier on all the threads.
+//!
+//! \param G The graph instance.
+//! \param r The root of the sample.
+//! \param generator The pseudo random number generator.
+//! \param result The vertices reached so far.
+//! \param frontier The reached vertices that still have to be expanded.
+//! \param max_frontier The largest frontier expanded sequentially.
+//! \return true if the sample is complete, its vertices sorted.
+template <typename GraphTy, typename PRNGeneratorTy>
+bool AddRRRSetBounded(const GraphTy &G, typename GraphTy::vertex_type r,
+                      PRNGeneratorTy &generator,
+                      std::vector<typename GraphTy::vertex_type> &result,
+                      std::vector<typename GraphTy::vertex_type> &frontier,
+                      size_t max_frontier) {
+  using vertex_type = typename GraphTy::vertex_type;
+
+  trng::uniform01_dist<float> value;
+
+  auto &scratch = thread_sampling_scratch<vertex_type>(G.num_nodes());
+  auto &queue = scratch.queue;
+  auto &visited = scratch.visited;
+
+  queue.push_back(r);
+  visited.insert(r);
+  result.push_back(r);
+
+  while (!queue.empty()) {
+    if (queue.size() > max_frontier) {
+      for (; !queue.empty(); queue.pop_front()) frontier.push_back(queue.front());
+      return false;
+    }
+
+    vertex_type v = queue.front();
+    queue.pop_front();
+    for_each_live_in_neighbor(G, v, generator, value, visited,
+                              [&](vertex_type u) {
+                                queue.push_back(u);
+                                visited.insert(u);
+                                result.push_back(u);
+                              });
+  }
+  SortRRRSet(result.begin(), result.end(), scratch.sort_buffer,
+             [&](vertex_type v) { return visited[v]; });
+  return true;
+}
+
+//! \brief Sample a live-edge world of the graph under the IC model.
+//!
+//! The liveness of every edge is drawn once, with the geometric skips over
+//! the recorded runs of the RRR set traversals, and the world is condensed for the RRR sets of many
+//! roots to be read from it.
+//!
+//! \param G The graph instance.
+//! \param generator The pseudo random number generator.
+//! \param world The world to build.
+template <typename GraphTy, typename PRNGeneratorTy>
+void SampleLiveEdgeWorld(const GraphTy &G, PRNGeneratorTy &generator,
+                         LiveEdgeWorld<typename GraphTy::vertex_type> &world) {
+  using vertex_type = typename GraphTy::vertex_type;
+  struct nothing_visited {
+    bool operator[](vertex_type) const { return false; }
+  };
+
+  trng::uniform01_dist<float> value;
+  world.build(G.num_nodes(), [&](vertex_type v, auto &&add) {
+    for_each_live_in_neighbor(G, v, generator, value, nothing_visited(), add);
+  });
+}
+
+//! \brief Expand a share of one level of a parallel IC traversal.
+//!
+//! The threads of the traversal call this concurrently on the same
+//! frontier: each claims blocks of frontier vertices from next until none is
+//! left, and collects the newly reached vertices in its own output.
+//!
+//! \param G The graph instance.
+//! \param frontier The vertices of the current level.
+//! \param next The index of the next unclaimed frontier vertex.
+//! \param generator The pseudo random number generator of the thread.
+//! \param visited The vertices reached by the traversal.
+//! \param out The vertices of the next level reached by this thread.
+template <typename GraphTy, typename PRNGeneratorTy>
+void ExpandRRRFrontier(
+    const GraphTy &G,
+    const std::vector<typename GraphTy::vertex_type> &frontier,
+    std::atomic<size_t> &next, PRNGeneratorTy &generator,
+    AtomicVisitedSet &visited,
+    std::vector<typename GraphTy::vertex_type> &out) {
+  using vertex_type = typename GraphTy::vertex_type;
+  constexpr size_t block = 64;
+
+  trng::uniform01_dist<float> value;
+  size_t first;
+  while ((first = next.fetch_add(block)) < frontier.size()) {
+    size_t last = std::min(first + block, frontier.size());
+    for (size_t i = first; i < last; ++i)
+      for_each_live_in_neighbor(G, frontier[i], generator, value, visited,
+                                [&](vertex_type u) {
+                                  if (visited.insert(u)) out.push_back(u);
+                                });
+  }
+}
 
-        if (threshold > 0) continue;
+//! \brief Sample up to 64 RRR sets under the IC model in one traversal.
+//!
+//! Every vertex carries a bitmask of the samples of the batch that reached
+//! it.  Expanding a vertex reads its in-neighbors once for all the samples
+//! pending on it, so every sample still flips each of its edges once and
+//! independently.  The recorded runs of unlikely edges are sampled with
+//! geometric skips over their (edge, sample) pairs, as
+//! for_each_live_in_neighbor does for a single sample.  The sets are extracted from the masks and sorted.
+//!
+//! \tparam GraphTy The type of the graph.
+//! \tparam PRNGeneratorTy The type of pseudo the random number generator.
+//! \tparam ItrTy The type of the iterator to the output RRR sets.
+//!
+//! \param G The graph instance.
+//! \param roots The roots of the samples.
+//! \param count The number of samples, at most bit_parallel_batch_size.
+//! \param generator The pseudo random number generator.
+//! \param first The output RRR sets, one per root.
+template <typename GraphTy, typename PRNGeneratorTy, typename ItrTy>
+void AddRRRSetBatch(const GraphTy &G,
+                    const typename GraphTy::vertex_type *roots, size_t count,
+                    PRNGeneratorTy &generator, ItrTy first,
+                    independent_cascade_tag &&) {
+  using vertex_type = typename GraphTy::vertex_type;
+  assert(count <= bit_parallel_batch_size);
+
+  trng::uniform01_dist<float> value;
+  trng::uniform01_dist<double> skip_value;
+
+  auto &scratch = thread_bit_parallel_scratch<vertex_type>(G.num_nodes());
+  auto &reached = scratch.reached;
+  auto &pending = scratch.pending;
+  auto &queue = scratch.queue;
+
+  auto reach = [&](vertex_type v, uint64_t mask) {
+    if (reached[v] == 0) scratch.touched.push_back(v);
+    reached[v] |= mask;
+    if (pending[v] == 0) queue.push_back(v);
+    pending[v] |= mask;
+  };
 
-        if (!visited[u.vertex]) {
-          queue.push_front(u.vertex);
-          visited[u.vertex] = true;
-          result.push_back(u.vertex);
+  for (size_t i = 0; i < count; ++i) reach(roots[i], uint64_t(1) << i);
+
+  while (!queue.empty()) {
+    vertex_type v = queue.front();
+    queue.pop_front();
+    uint64_t mask = pending[v];
+    pending[v] = 0;
+
+    unsigned char samples[bit_parallel_batch_size];
+    size_t num_samples = 0;
+    for (uint64_t m = mask; m != 0; m &= m - 1)
+      samples[num_samples++] = __builtin_ctzll(m);
+
+    auto neighborhood = G.neighbors(v);
+    auto begin = neighborhood.begin();
+    auto flip = [&](size_t from, size_t to) {
+      for (auto itr = std::next(begin, from); from != to; ++from, ++itr) {
+        auto u = *itr;
+        uint64_t candidates = mask & ~reached[u.vertex];
+        uint64_t live = 0;
+        for (; candidates != 0; candidates &= candidates - 1) {
+          if (is_live_edge(u, generator, value))
+            live |= candidates & (~candidates + 1);
         }
-        break;
+        if (live != 0) reach(u.vertex, live);
+      }
+    };
+
+    size_t position = 0;
+    auto runs = ic_runs(G, v, 0);
+    for (auto run = runs.first; run != runs.second; ++run) {
+      flip(position, run->begin);
+      position = run->end;
+
+      auto run_begin = std::next(begin, run->begin);
+      double p = edge_probability(*run_begin);
+      if (p > geometric_skip_max_probability) {
+        flip(run->begin, run->end);
+        continue;
+      }
+      if (p <= 0) continue;
+
+      // The (edge, sample) pairs of the run are independent coin flips of
+      // parameter p: jump from one live pair to the next.
+      double log_q = std::log1p(-p);
+      size_t trials = (run->end - run->begin) * num_samples;
+      size_t offset = 0;
+      while (true) {
+        double skip = std::floor(std::log(1.0 - skip_value(generator)) / log_q);
+        if (skip >= double(trials - offset)) break;
+        offset += size_t(skip);
+        auto u = *std::next(run_begin, offset / num_samples);
+        uint64_t bit = uint64_t(1) << samples[offset % num_samples];
+        if (!(reached[u.vertex] & bit)) reach(u.vertex, bit);
+        if (++offset == trials) break;
+      }
+    }
+    flip(position, G.degree(v));
+  }
+
+  for (auto v : scratch.touched) {
+    for (uint64_t mask = reached[v]; mask != 0; mask &= mask - 1)
+      scratch.sets[__builtin_ctzll(mask)].push_back(v);
+  }
+  for (size_t i = 0; i < count; ++i, ++first) {
+    auto &S = scratch.sets[i];
+    SortRRRSet(S.begin(), S.end(), scratch.sort_buffer,
+               [&](vertex_type v) { return reached[v] >> i & 1; });
+    (*first).assign(S.begin(), S.end());
+  }
+}
+
+//! The number of LT walks advanced in lockstep by AddRRRSetBatch.
+constexpr size_t interleaved_walk_lanes = 16;
+
+//! \brief Sample up to 64 RRR sets under the LT model with interleaved walks.
+//!
+//! An LT RRR set is a reverse random walk that stops at the first vertex
+//! without a live in-edge or at the first revisit, so a single walk spends
+//! most of its time waiting on the CSR index and on the neighbor list of
+//! the next vertex.  Here up to 16 walks advance in lockstep: each round
+//! first prefetches the index entries of the current vertices of all the
+//! lanes, then their neighbor lists, and only then takes one step on every
+//! lane, so that the cache misses of independent walks overlap.  A walk
+//! that terminates is retired into its output set and its lane restarts
+//! from the next root.  Bit l of the per-vertex masks of the bit-parallel
+//! scratch marks the vertices visited by the walk on lane l.
+//!
+//! \tparam GraphTy The type of the graph.
+//! \tparam PRNGeneratorTy The type of pseudo the random number generator.
+//! \tparam ItrTy The type of the iterator to the output RRR sets.
+//!
+//! \param G The graph instance.
+//! \param roots The roots of the samples.
+//! \param count The number of samples, at most bit_parallel_batch_size.
+//! \param generator The pseudo random number generator.
+//! \param first The output RRR sets, one per root.
+template <typename GraphTy, typename PRNGeneratorTy, typename ItrTy>
+void AddRRRSetBatch(const GraphTy &G,
+                    const typename GraphTy::vertex_type *roots, size_t count,
+                    PRNGeneratorTy &generator, ItrTy first,
+                    linear_threshold_tag &&) {
+  using vertex_type = typename GraphTy::vertex_type;
+  assert(count <= bit_parallel_batch_size);
+
+  trng::uniform01_dist<float> value;
+
+  auto &scratch = thread_bit_parallel_scratch<vertex_type>(G.num_nodes());
+  auto &reached = scratch.reached;
+  auto *index = G.csr_index();
+
+  vertex_type current[interleaved_walk_lanes];
+  size_t sample[interleaved_walk_lanes];
+  bool active[interleaved_walk_lanes];
+  size_t lanes = std::min(count, interleaved_walk_lanes);
+  size_t next = 0;
+
+  auto start = [&](size_t lane) {
+    vertex_type r = roots[next];
+    sample[lane] = next++;
+    current[lane] = r;
+    reached[r] |= uint64_t(1) << lane;
+    scratch.sets[lane].assign(1, r);
+  };
+  auto retire = [&](size_t lane) {
+    auto &S = scratch.sets[lane];
+    SortRRRSet(S.begin(), S.end(), scratch.sort_buffer,
+               [&](vertex_type v) { return reached[v] >> lane & 1; });
+    for (auto v : S) reached[v] &= ~(uint64_t(1) << lane);
+    auto out = first;
+    std::advance(out, sample[lane]);
+    (*out).assign(S.begin(), S.end());
+  };
+
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    start(lane);
+    active[lane] = true;
+  }
+
+  size_t num_active = lanes;
+  while (num_active != 0) {
+    for (size_t lane = 0; lane < lanes; ++lane)
+      if (active[lane]) __builtin_prefetch(index + current[lane]);
+    for (size_t lane = 0; lane < lanes; ++lane)
+      if (active[lane]) prefetch_in_edges(G, current[lane], 0);
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      if (!active[lane]) continue;
+
+      uint64_t bit = uint64_t(1) << lane;
+      vertex_type u;
+      if (live_in_neighbor(G, current[lane], generator, value, u) &&
+          !(reached[u] & bit)) {
+        reached[u] |= bit;
+        scratch.sets[lane].push_back(u);
+        current[lane] = u;
+        continue;
+      }
+
+      retire(lane);
+      if (next < count) {
+        start(lane);
+      } else {
+        active[lane] = false;
+        --num_active;
       }
-    } else {
-      throw;
     }
   }
-  result.shrink_to_fit(); // try collect memory 
-  std::deque<vertex_type>().swap(queue);
-  std::vector<bool>().swap(visited);
 }
 
 //! \brief Generate Random Reverse Reachability Sets - sequential.
@@ -297,6 +927,7 @@ void GenerateRRRSets2(GraphTy &G, PRNGeneratorTy &generator,
     typename GraphTy::vertex_type r = start(generator[0]);
     AddRRRSet2(G, r, generator[0], *itr,
               std::forward<diff_model_tag>(model_tag));
+    (*itr).shrink_to_fit();
   }
 }
 
@@ -335,8 +966,10 @@ void GenerateRRRSets2(const GraphTy &G,
                      ExecRecordTy &,
                      diff_model_tag &&,
                      omp_parallel_tag &&,
-                     std::vector<uint32_t> &globalcnt, vertex_type* maxvtx) {
-  se.generate2(begin, end, globalcnt, maxvtx);
+                     std::vector<uint32_t> &globalcnt, vertex_type* maxvtx,
+                     CountStatistics *stats = nullptr,
+                     const std::function<void(ItrTy, ItrTy)> &sink = {}) {
+  se.generate2(begin, end, globalcnt, maxvtx, stats, sink);
 }
 
 }  // namespace ripples
@@ -44,11 +44,20 @@
 #define RIPPLES_GRAPH_H
 
 #include <algorithm>
+#include <cmath>
 #include <cstddef>
-#include <map>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
 #include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
+#include <ripples/mapped_file.h>
 #include <ripples/utility.h>
 
 namespace ripples {
@@ -66,7 +75,7 @@ struct ForwardDirection {
   //! \return The source of the egde to be loaded in the graph.
   template <typename ItrTy, typename MapTy>
   static VertexTy Source(ItrTy itr, const MapTy &m) {
-    return m.find(itr->source)->second;
+    return m[itr->source];
   }
 
   //! \brief Edge Destination
@@ -77,7 +86,7 @@ struct ForwardDirection {
   //! \return The destination of the egde to be loaded in the graph.
   template <typename ItrTy, typename MapTy>
   static VertexTy Destination(ItrTy itr, const MapTy &m) {
-    return m.find(itr->destination)->second;
+    return m[itr->destination];
   }
 };
 
@@ -94,7 +103,7 @@ struct BackwardDirection {
   //! \return The source of the egde to be loaded in the graph.
   template <typename ItrTy, typename MapTy>
   static VertexTy Source(ItrTy itr, const MapTy &m) {
-    return m.find(itr->destination)->second;
+    return m[itr->destination];
   }
 
   //! \brief Edge Destination
@@ -105,7 +114,7 @@ struct BackwardDirection {
   //! \return The destination of the egde to be loaded in the graph.
   template <typename ItrTy, typename MapTy>
   static VertexTy Destination(ItrTy itr, const MapTy &m) {
-    return m.find(itr->source)->second;
+    return m[itr->source];
   }
 };
 
@@ -155,6 +164,9 @@ struct Destination {
   bool operator==(const Destination &O) const {
     return this->vertex == O.vertex;
   }
+  bool operator<(const Destination &O) const {
+    return this->vertex < O.vertex;
+  }
   template <typename Direction, typename Itr, typename IDMap>
   static Destination Create(Itr itr, IDMap &IM) {
     Destination dst{Direction::Destination(itr, IM)};
@@ -175,6 +187,10 @@ struct WeightedDestination : public Destination<VertexTy> {
   bool operator==(const WeightedDestination &O) const {
     return Destination<VertexTy>::operator==(O) && this->weight == O.weight;
   }
+  bool operator<(const WeightedDestination &O) const {
+    return this->vertex < O.vertex ||
+           (this->vertex == O.vertex && this->weight < O.weight);
+  }
   template <typename Direction, typename Itr, typename IDMap>
   static WeightedDestination Create(Itr itr, IDMap &IM) {
     WeightedDestination dst{Direction::Destination(itr, IM), itr->weight};
@@ -182,6 +198,302 @@ struct WeightedDestination : public Destination<VertexTy> {
   }
 };
 
+//! \brief CSR edge storing its probability as an integer threshold.
+//!
+//! The probability p of the edge is stored as T = round(p * 2^32), clamped to
+//! 2^32 - 1, so that the edge is live when 32 raw random bits r satisfy
+//! r < T.  Traversals compare raw generator output with T and never convert
+//! it to floating point.  The clamping makes p = 1 fail with probability
+//! 2^-32.
+//!
+//! \tparam VertexTy The type of the vertex.
+template <typename VertexTy>
+struct ThresholdDestination : public Destination<VertexTy> {
+  //! The type of the weights the thresholds are built from.
+  using edge_weight = float;
+  uint32_t threshold;  //!< The edge probability scaled to 2^32.
+
+  ThresholdDestination(VertexTy v, uint32_t t)
+      : Destination<VertexTy>{v}, threshold(t) {}
+  ThresholdDestination() : ThresholdDestination(VertexTy(), 0) {}
+
+  //! Convert a probability into a threshold.
+  static uint32_t ToThreshold(float p) {
+    double t = std::round(double(p) * 4294967296.0);
+    return t <= 0 ? 0 : t >= 4294967295.0 ? 4294967295u : uint32_t(t);
+  }
+
+  bool operator==(const ThresholdDestination &O) const {
+    return Destination<VertexTy>::operator==(O) &&
+           this->threshold == O.threshold;
+  }
+  bool operator<(const ThresholdDestination &O) const {
+    return this->vertex < O.vertex ||
+           (this->vertex == O.vertex && this->threshold < O.threshold);
+  }
+  //! Convert a weighted edge into a threshold edge.
+  template <typename WeightTy>
+  static ThresholdDestination
+  FromWeighted(const WeightedDestination<VertexTy, WeightTy> &u) {
+    return ThresholdDestination(u.vertex, ToThreshold(u.weight));
+  }
+
+  template <typename Direction, typename Itr, typename IDMap>
+  static ThresholdDestination Create(Itr itr, IDMap &IM) {
+    ThresholdDestination dst{Direction::Destination(itr, IM),
+                             ToThreshold(itr->weight)};
+    return dst;
+  }
+};
+
+//! Does a CSR edge type store integer thresholds?
+template <typename DestinationTy>
+struct is_threshold_destination : std::false_type {};
+
+template <typename VertexTy>
+struct is_threshold_destination<ThresholdDestination<VertexTy>>
+    : std::true_type {};
+
+//! \brief Map from the original vertex IDs to the internal vertex IDs.
+//!
+//! The map is built from the reverse map of a graph and picks the most compact
+//! representation available: nothing when the IDs were not renumbered, the
+//! sorted original IDs when the internal IDs follow their order, and sorted
+//! (original, internal) pairs otherwise.  Lookups are binary searches.
+//!
+//! \tparam VertexTy The integer type representing a vertex of the graph.
+template <typename VertexTy>
+class VertexIDMap {
+ public:
+  //! Empty map.
+  VertexIDMap() : identity_(true), size_(0), keys_(), values_() {}
+
+  //! Build the map inverting a reverse map.
+  //!
+  //! \param reverseMap The original ID of each internal vertex ID.
+  explicit VertexIDMap(const std::vector<VertexTy> &reverseMap)
+      : identity_(true), size_(reverseMap.size()), keys_(), values_() {
+    bool identity = true;
+    bool sorted = true;
+#pragma omp parallel for reduction(&& : identity, sorted)
+    for (size_t i = 0; i < reverseMap.size(); ++i) {
+      identity = identity && reverseMap[i] == i;
+      sorted = sorted && (i == 0 || reverseMap[i - 1] < reverseMap[i]);
+    }
+    identity_ = identity;
+    if (identity_) return;
+
+    keys_ = reverseMap;
+    if (sorted) return;
+
+    std::vector<std::pair<VertexTy, VertexTy>> pairs(size_);
+#pragma omp parallel for
+    for (size_t i = 0; i < size_; ++i) pairs[i] = {reverseMap[i], VertexTy(i)};
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [](const std::pair<VertexTy, VertexTy> &a,
+                        const std::pair<VertexTy, VertexTy> &b) {
+                       return a.first < b.first;
+                     });
+    pairs.erase(std::unique(pairs.begin(), pairs.end(),
+                            [](const std::pair<VertexTy, VertexTy> &a,
+                               const std::pair<VertexTy, VertexTy> &b) {
+                              return a.first == b.first;
+                            }),
+                pairs.end());
+
+    keys_.resize(pairs.size());
+    values_.resize(pairs.size());
+#pragma omp parallel for
+    for (size_t i = 0; i < pairs.size(); ++i) {
+      keys_[i] = pairs[i].first;
+      values_[i] = pairs[i].second;
+    }
+  }
+
+  //! Look up a vertex that is known to be in the map.
+  //!
+  //! \param v The original vertex ID.
+  //! \return the internal vertex ID of v.
+  VertexTy operator[](VertexTy v) const {
+    if (identity_) return v;
+    size_t pos = std::lower_bound(keys_.begin(), keys_.end(), v) - keys_.begin();
+    return values_.empty() ? VertexTy(pos) : values_[pos];
+  }
+
+  //! Look up a vertex.
+  //!
+  //! \param v The original vertex ID.
+  //! \param id The internal vertex ID of v, when found.
+  //! \return true if v is in the map.
+  bool find(VertexTy v, VertexTy &id) const {
+    if (identity_) {
+      id = v;
+      return v < size_;
+    }
+    auto itr = std::lower_bound(keys_.begin(), keys_.end(), v);
+    if (itr == keys_.end() || *itr != v) return false;
+    size_t pos = itr - keys_.begin();
+    id = values_.empty() ? VertexTy(pos) : values_[pos];
+    return true;
+  }
+
+ private:
+  bool identity_;
+  size_t size_;
+  std::vector<VertexTy> keys_;
+  std::vector<VertexTy> values_;
+};
+
+//! \brief Header of the binary graph format.
+//!
+//! A binary dump is the header followed by three sections: the reverse map,
+//! the CSR index stored as offsets into the edge array, and the CSR edges.
+//! Dumps of graphs carrying a linear threshold index (see
+//! Graph::build_lt_index) have a fourth section with the cumulative weights.
+//! Every section starts at a multiple of BinaryGraphHeader::alignment, so that
+//! a mapping of the file can be used in place without any copy or fix-up.
+//! All the fields and sections are stored in little-endian.
+struct BinaryGraphHeader {
+  //! "RPLGRAPH" read as a little-endian 64-bit integer.
+  static constexpr uint64_t magic_number = 0x48504152474C5052ULL;
+  //! The version of the format.  Dumps without a header are version 1.
+  static constexpr uint32_t current_version = 2;
+  //! The alignment of each section in the file.
+  static constexpr uint64_t alignment = 4096;
+  //! The graph stored in the dump is in the backward direction.
+  static constexpr uint32_t backward_direction_flag = 1;
+  //! The dump stores the cumulative in-edge weights after the CSR edges.
+  static constexpr uint32_t lt_index_flag = 2;
+
+  uint64_t magic;               //!< Must be equal to magic_number.
+  uint32_t version;             //!< The version of the format.
+  uint32_t flags;               //!< Properties of the stored graph.
+  uint32_t vertex_size;         //!< sizeof(VertexTy) of the stored graph.
+  uint32_t edge_size;           //!< sizeof(DestinationTy) of the stored graph.
+  uint64_t num_nodes;           //!< The number of vertices.
+  uint64_t num_edges;           //!< The number of edges.
+  uint64_t reverse_map_offset;  //!< Start of the reverse map section.
+  uint64_t index_offset;        //!< Start of the CSR index section.
+  uint64_t edges_offset;        //!< Start of the CSR edges section.
+  uint64_t file_size;           //!< Total size of the dump in bytes.
+
+  //! Round an offset up to the section alignment.
+  static uint64_t align(uint64_t offset) {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  //! Build the header describing a graph and lay out its sections.
+  //!
+  //! \tparam VertexTy The type of the vertices of the graph.
+  //! \tparam DestinationTy The type of the elements of the edge array.
+  //!
+  //! \param nodes The number of vertices.
+  //! \param edges The number of edges.
+  //! \param forward Is the graph in the forward direction?
+  //! \param lt_index Does the dump store the linear threshold index?
+  //! \return the header of the dump.
+  template <typename VertexTy, typename DestinationTy>
+  static BinaryGraphHeader Create(uint64_t nodes, uint64_t edges,
+                                  bool forward, bool lt_index = false) {
+    BinaryGraphHeader H;
+    H.magic = magic_number;
+    H.version = current_version;
+    H.flags = (forward ? 0 : backward_direction_flag) |
+              (lt_index ? lt_index_flag : 0);
+    H.vertex_size = sizeof(VertexTy);
+    H.edge_size = sizeof(DestinationTy);
+    H.num_nodes = nodes;
+    H.num_edges = edges;
+    H.reverse_map_offset = align(sizeof(BinaryGraphHeader));
+    H.index_offset = align(H.reverse_map_offset + nodes * sizeof(VertexTy));
+    H.edges_offset = align(H.index_offset + (nodes + 1) * sizeof(uint64_t));
+    H.file_size = H.edges_offset + edges * sizeof(DestinationTy);
+    if (lt_index) H.file_size = H.lt_index_offset() + edges * sizeof(float);
+    return H;
+  }
+
+  //! Is the stored graph in the forward direction?
+  bool forward() const { return !(flags & backward_direction_flag); }
+
+  //! Does the dump store the linear threshold index?
+  bool has_lt_index() const { return flags & lt_index_flag; }
+
+  //! Start of the linear threshold index section, when present.
+  uint64_t lt_index_offset() const {
+    return align(edges_offset + num_edges * edge_size);
+  }
+
+  //! Check that the dump can be loaded in a graph with the given layout.
+  //!
+  //! The sections must be aligned, in order, and within the dump, so that a
+  //! corrupt header cannot make a mapping read out of bounds.
+  //!
+  //! \tparam VertexTy The type of the vertices of the graph.
+  //! \tparam DestinationTy The type of the elements of the edge array.
+  //!
+  //! \param size The number of bytes available in the dump.
+  template <typename VertexTy, typename DestinationTy>
+  void validate(uint64_t size) const {
+    if (magic != magic_number)
+      throw std::runtime_error("Not a binary graph dump");
+    if (version != current_version)
+      throw std::runtime_error("Unsupported binary graph version");
+    if (vertex_size != sizeof(VertexTy) || edge_size != sizeof(DestinationTy))
+      throw std::runtime_error("Binary graph layout does not match the graph");
+    if (file_size > size) throw std::runtime_error("Truncated binary graph");
+    bool in_bounds =
+        reverse_map_offset >= sizeof(BinaryGraphHeader) &&
+        section_fits(reverse_map_offset, num_nodes, vertex_size,
+                     index_offset) &&
+        section_fits(index_offset, num_nodes + 1, sizeof(uint64_t),
+                     edges_offset) &&
+        section_fits(edges_offset, num_edges, edge_size, file_size);
+    if (in_bounds && has_lt_index())
+      in_bounds = section_fits(lt_index_offset(), num_edges, sizeof(float),
+                               file_size);
+    if (!in_bounds)
+      throw std::runtime_error("Corrupt binary graph section layout");
+  }
+
+  //! Check the CSR index read from a dump against the number of edges.
+  //!
+  //! \param index The CSR index of the dump, in host byte order.
+  template <typename IndexTy>
+  void validate_index(const IndexTy *index) const {
+    if (index[0] != 0 || index[num_nodes] != num_edges)
+      throw std::runtime_error("Corrupt binary graph index");
+  }
+
+  //! Does an aligned section of count elements of the given size start at
+  //! offset and end before end?  Written not to overflow on corrupt headers.
+  static bool section_fits(uint64_t offset, uint64_t count,
+                           uint64_t element_size, uint64_t end) {
+    return offset % alignment == 0 && offset <= end &&
+           count <= (end - offset) / element_size;
+  }
+
+  //! Convert the fields between host and little-endian byte order.
+  void swap_little_endian() {
+    magic = htole64(magic);
+    version = htole32(version);
+    flags = htole32(flags);
+    vertex_size = htole32(vertex_size);
+    edge_size = htole32(edge_size);
+    num_nodes = htole64(num_nodes);
+    num_edges = htole64(num_edges);
+    reverse_map_offset = htole64(reverse_map_offset);
+    index_offset = htole64(index_offset);
+    edges_offset = htole64(edges_offset);
+    file_size = htole64(file_size);
+  }
+};
+
+//! \brief A run of consecutive edges of a neighborhood with equal weights.
+struct EdgeRun {
+  uint64_t begin;  //!< Offset of the first edge of the run in the neighborhood.
+  uint64_t end;    //!< Offset past the last edge of the run.
+};
+
 //! \brief The Graph data structure.
 //!
 //! A graph in CSR format.  The construction method takes care of projecting the
@@ -189,6 +501,10 @@ struct WeightedDestination : public Destination<VertexTy> {
 //! in order to build the CSR representation.  However, the data structure
 //! stores a map that allows to project back the IDs into the original space.
 //!
+//! The CSR index stores offsets into the edge array rather than pointers, so
+//! that a binary dump can be memory mapped and used in place (see
+//! Graph::map_binary).
+//!
 //! \tparam VertexTy The integer type representing a vertex of the graph.
 //! \tparam DestinationTy The type representing the element of the edge array.
 //! \tparam DirectionPolicy The policy encoding the graph direction with repect
@@ -204,6 +520,12 @@ class Graph {
   using edge_type = DestinationTy;
   //! The integer type representing vertices in the graph.
   using vertex_type = VertexTy;
+  //! The type of the entries of the CSR index.
+  using index_type = uint64_t;
+  //! The type of the cumulative weights of the linear threshold index.
+  using lt_weight_type = float;
+  //! The policy encoding the direction of the graph.
+  using direction_type = DirectionPolicy;
 
   //! \brief The neighborhood of a vertex.
   class Neighborhood {
@@ -233,45 +555,38 @@ class Graph {
         index(nullptr),
         edges(nullptr),
         idMap(),
-        reverseMap() {}
+        reverseMap(),
+        ltIndex(nullptr),
+        ltIndexStorage(),
+        icRunIndex(),
+        icRuns(),
+        mapping() {}
 
   Graph(const Graph &O)
       : numNodes(O.numNodes),
         numEdges(O.numEdges),
         idMap(O.idMap),
-        reverseMap(O.reverseMap) {
-    edges = new edge_type[numEdges];
-    index = new edge_type *[numNodes + 1];
-#pragma omp parallel for
-    for (size_t i = 0; i < numEdges; ++i) {
-      edges[i] = O.edges[i];
-    }
-
-#pragma omp parallel for
-    for (size_t i = 0; i < numNodes + 1; ++i) {
-      index[i] = edges + (reinterpret_cast<uint64_t>(O.index[i]) -
-                          reinterpret_cast<uint64_t>(O.index));
-    }
+        reverseMap(O.reverseMap),
+        ltIndex(nullptr),
+        ltIndexStorage(),
+        icRunIndex(),
+        icRuns(),
+        mapping() {
+    copy_csr(O);
   }
 
   Graph &operator=(const Graph &O) {
+    if (this == &O) return *this;
+
+    release_csr();
+
     numNodes = O.numNodes;
     numEdges = O.numEdges;
     idMap = O.idMap;
     reverseMap = O.reverseMap;
 
-    edges = new edge_type[numEdges];
-    index = new edge_type *[numNodes + 1];
-#pragma omp parallel for
-    for (size_t i = 0; i < numEdges; ++i) {
-      edges[i] = O.edges[i];
-    }
-
-#pragma omp parallel for
-    for (size_t i = 0; i < numNodes + 1; ++i) {
-      index[i] = edges + (reinterpret_cast<uint64_t>(O.index[i]) -
-                          reinterpret_cast<uint64_t>(O.index));
-    }
+    copy_csr(O);
+    return *this;
   }
 
   //! Move constructor.
@@ -282,11 +597,17 @@ class Graph {
         index(O.index),
         edges(O.edges),
         idMap(std::move(O.idMap)),
-        reverseMap(std::move(O.reverseMap)) {
+        reverseMap(std::move(O.reverseMap)),
+        ltIndex(O.ltIndex),
+        ltIndexStorage(std::move(O.ltIndexStorage)),
+        icRunIndex(std::move(O.icRunIndex)),
+        icRuns(std::move(O.icRuns)),
+        mapping(std::move(O.mapping)) {
     O.numNodes = 0;
     O.numEdges = 0;
     O.index = nullptr;
     O.edges = nullptr;
+    O.ltIndex = nullptr;
   }
 
   //! Move assignment operator.
@@ -295,8 +616,7 @@ class Graph {
   Graph &operator=(Graph &&O) {
     if (this == &O) return *this;
 
-    delete[] index;
-    delete[] edges;
+    release_csr();
 
     numNodes = O.numNodes;
     numEdges = O.numEdges;
@@ -304,11 +624,17 @@ class Graph {
     edges = O.edges;
     idMap = std::move(O.idMap);
     reverseMap = std::move(O.reverseMap);
+    ltIndex = O.ltIndex;
+    ltIndexStorage = std::move(O.ltIndexStorage);
+    icRunIndex = std::move(O.icRunIndex);
+    icRuns = std::move(O.icRuns);
+    mapping = std::move(O.mapping);
 
     O.numNodes = 0;
     O.numEdges = 0;
     O.index = nullptr;
     O.edges = nullptr;
+    O.ltIndex = nullptr;
 
     return *this;
   }
@@ -318,8 +644,9 @@ class Graph {
   //! \tparam FStream The type of the input stream.
   //!
   //! \param FS The binary stream containing the graph dump.
-  template <typename FStream>
-  Graph(FStream &FS) {
+  template <typename FStream, typename = typename std::enable_if<
+                                 !std::is_same<FStream, Graph>::value>::type>
+  Graph(FStream &FS) : Graph() {
     load_binary(FS);
   }
 
@@ -335,66 +662,13 @@ class Graph {
   //! \param begin The start of the edge list.
   //! \param end The end of the edge list.
   template <typename EdgeIterator>
-  Graph(EdgeIterator begin, EdgeIterator end, bool renumbering) {
-    for (auto itr = begin; itr != end; ++itr) {
-      idMap[itr->source];
-      idMap[itr->destination];
-    }
-
-    size_t num_nodes = renumbering ? idMap.size() : idMap.rbegin()->first + 1;
-    size_t num_edges = std::distance(begin, end);
-
-    index = new edge_type *[num_nodes + 1];
-    edges = new edge_type[num_edges];
-
-#pragma omp parallel for
-    for (size_t i = 0; i < num_nodes + 1; ++i) {
-      index[i] = edges;
-    }
-
-#pragma omp parallel for
-    for (size_t i = 0; i < num_edges; ++i) {
-      edges[i] = DestinationTy();
-    }
-
-    numNodes = num_nodes;
-    numEdges = num_edges;
-
-    VertexTy currentID{0};
-    reverseMap.resize(numNodes);
-    for (auto itr = std::begin(idMap), end = std::end(idMap); itr != end;
-         ++itr) {
-      if (!renumbering) {
-        reverseMap.at(itr->first) = itr->first;
-        itr->second = itr->first;
-      } else {
-        reverseMap[currentID] = itr->first;
-        itr->second = currentID;
-        currentID++;
-      }
-    }
-
-    for (auto itr = begin; itr != end; ++itr) {
-      index[DirectionPolicy::Source(itr, idMap) + 1] += 1;
-    }
-
-    for (size_t i = 1; i <= num_nodes; ++i) {
-      index[i] += index[i - 1] - edges;
-    }
-
-    std::vector<edge_type *> ptrEdge(index, index + num_nodes);
-    for (auto itr = begin; itr != end; ++itr) {
-      *ptrEdge[DirectionPolicy::Source(itr, idMap)] =
-          edge_type::template Create<DirectionPolicy>(itr, idMap);
-      ++ptrEdge[DirectionPolicy::Source(itr, idMap)];
-    }
+  Graph(EdgeIterator begin, EdgeIterator end, bool renumbering) : Graph() {
+    build(begin, end, renumbering,
+          typename std::iterator_traits<EdgeIterator>::iterator_category());
   }
 
   //! \brief Destuctor.
-  ~Graph() {
-    if (index) delete[] index;
-    if (edges) delete[] edges;
-  }
+  ~Graph() { release_csr(); }
 
   //! Returns the out-degree of a vertex.
   //! \param v The input vertex.
@@ -405,7 +679,7 @@ class Graph {
   //! \param v The input vertex.
   //! \return  a range containing the out-neighbors of the vertex v in input.
   Neighborhood neighbors(VertexTy v) const {
-    return Neighborhood(index[v], index[v + 1]);
+    return Neighborhood(edges + index[v], edges + index[v + 1]);
   }
 
   //! The number of nodes in the Graph.
@@ -416,6 +690,88 @@ class Graph {
   //! \return The number of edges in the Graph.
   size_t num_edges() const { return numEdges; }
 
+  //! \brief Build the linear threshold index of the graph.
+  //!
+  //! The index stores, in parallel to the edge array, the inclusive prefix
+  //! sum of the edge weights of each neighborhood.  On a backward graph it
+  //! turns the choice of the live in-edge of a vertex under the Linear
+  //! Threshold model into a binary search over its in-degree.  The index is
+  //! stored in binary dumps and restored when they are loaded.
+  template <typename EdgeTy = edge_type>
+  auto build_lt_index() -> decltype(std::declval<EdgeTy>().weight, void()) {
+    ltIndexStorage.resize(numEdges);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      lt_weight_type sum = 0;
+      for (index_type i = index[v]; i < index[v + 1]; ++i) {
+        sum += edges[i].weight;
+        ltIndexStorage[i] = sum;
+      }
+    }
+    ltIndex = ltIndexStorage.data();
+  }
+
+  //! Does the graph carry the linear threshold index?
+  bool has_lt_index() const { return ltIndex != nullptr; }
+
+  //! The cumulative weights of the neighborhood of a vertex.
+  //! \param v The input vertex.
+  //! \return a pointer to the cumulative weight of the first neighbor of v.
+  const lt_weight_type *lt_index(VertexTy v) const {
+    return ltIndex + index[v];
+  }
+
+  //! \brief Build the equal-weight run index of the graph.
+  //!
+  //! The index records, for every neighborhood, the runs of at least
+  //! min_length consecutive edges with the same weight, as produced by the
+  //! weighted cascade, constant or bucketed weights.  The IC samplers jump
+  //! within such a run with index arithmetic, so that they read only the live
+  //! edges of a run of unlikely edges.  Random weights give no runs, and the
+  //! index is then only one offset per vertex.
+  //!
+  //! \param min_length The length of the shortest run recorded.
+  void build_ic_runs(size_t min_length = 8) {
+    // Two edges have the same weight when they differ only by their vertex.
+    auto same_weight = [&](index_type i) {
+      edge_type e = edges[i];
+      e.vertex = edges[i - 1].vertex;
+      return e == edges[i - 1];
+    };
+    auto for_each_run = [&](size_t v, auto &&fn) {
+      index_type first = index[v];
+      for (index_type i = index[v] + 1; i <= index[v + 1]; ++i) {
+        if (i < index[v + 1] && same_weight(i)) continue;
+        if (size_t(i - first) >= min_length)
+          fn(EdgeRun{uint64_t(first - index[v]), uint64_t(i - index[v])});
+        first = i;
+      }
+    };
+
+    icRunIndex.assign(numNodes + 1, 0);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v)
+      for_each_run(v, [&](EdgeRun) { ++icRunIndex[v + 1]; });
+    parallel_prefix_sum(icRunIndex.data(), icRunIndex.data() + numNodes + 1);
+
+    icRuns.resize(icRunIndex[numNodes]);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      size_t next = icRunIndex[v];
+      for_each_run(v, [&](EdgeRun run) { icRuns[next++] = run; });
+    }
+  }
+
+  //! Does the graph carry the equal-weight run index?
+  bool has_ic_runs() const { return !icRunIndex.empty(); }
+
+  //! The equal-weight runs of the neighborhood of a vertex.
+  //! \param v The input vertex.
+  //! \return the runs of v, in order, as a pair of pointers.
+  std::pair<const EdgeRun *, const EdgeRun *> ic_runs(VertexTy v) const {
+    return {icRuns.data() + icRunIndex[v], icRuns.data() + icRunIndex[v + 1]};
+  }
+
   //! Convert a list of vertices from the interal representation to the original
   //! input representation.
   //!
@@ -458,36 +814,112 @@ class Graph {
   }
 
   vertex_type transformID(const vertex_type v) const {
-    auto itr = idMap.find(v);
-    if (itr != idMap.end())
-      return itr->second;
+    vertex_type id;
+    if (idMap.find(v, id))
+      return id;
     else
       throw "Bad node";
   }
 
   //! Dump the internal representation to a binary stream.
   //!
+  //! The dump follows the layout described by BinaryGraphHeader and can be
+  //! reloaded either through a stream or through Graph::map_binary.
+  //!
   //! \tparam FStream The type of the output stream
   //!
   //! \param FS The ouput file stream.
   template <typename FStream>
   void dump_binary(FStream &FS) const {
-    uint64_t num_nodes = htole64(numNodes);
-    uint64_t num_edges = htole64(numEdges);
-    FS.write(reinterpret_cast<const char *>(&num_nodes), sizeof(uint64_t));
-    FS.write(reinterpret_cast<const char *>(&num_edges), sizeof(uint64_t));
-
+    auto header = BinaryGraphHeader::Create<VertexTy, edge_type>(
+        numNodes, numEdges, isForward, has_lt_index());
+    BinaryGraphHeader le_header(header);
+    le_header.swap_little_endian();
+
+    uint64_t position = 0;
+    auto pad_to = [&](uint64_t offset) {
+      std::vector<char> zeros(offset - position, 0);
+      FS.write(zeros.data(), zeros.size());
+      position = offset;
+    };
+
+    FS.write(reinterpret_cast<const char *>(&le_header), sizeof(le_header));
+    position += sizeof(le_header);
+
+    pad_to(header.reverse_map_offset);
     sequence_of<VertexTy>::dump(FS, reverseMap.begin(), reverseMap.end());
+    position += numNodes * sizeof(VertexTy);
+
+    pad_to(header.index_offset);
+    sequence_of<index_type>::dump(FS, index, index + numNodes + 1);
+    position += (numNodes + 1) * sizeof(index_type);
 
-    using relative_index =
-        typename std::iterator_traits<edge_type *>::difference_type;
-    std::vector<relative_index> relIndex(numNodes + 1, 0);
-    std::transform(index, index + numNodes + 1, relIndex.begin(),
-                   [=](edge_type *v) -> relative_index {
-                     return std::distance(edges, v);
-                   });
-    sequence_of<relative_index>::dump(FS, relIndex.begin(), relIndex.end());
+    pad_to(header.edges_offset);
     sequence_of<edge_type>::dump(FS, edges, edges + numEdges);
+    position += numEdges * sizeof(edge_type);
+
+    if (!has_lt_index()) return;
+    pad_to(header.lt_index_offset());
+    sequence_of<lt_weight_type>::dump(FS, ltIndex, ltIndex + numEdges);
+  }
+
+  //! \brief Load a binary dump by mapping it in memory.
+  //!
+  //! The CSR of the returned graph points directly into a shared read-only
+  //! mapping of the file: loading does not copy the edge array, and
+  //! concurrent processes loading the same dump share one page-cache copy of
+  //! it.  Legacy dumps, and any dump on big-endian hosts, are loaded through
+  //! the stream reader instead.  A dump stored in the opposite direction is
+  //! mapped and transposed.
+  //!
+  //! \param FileName The path of the binary dump.
+  //! \return the graph stored in the dump.
+  static Graph map_binary(const std::string &FileName) {
+    static_assert(sizeof(index_type) == sizeof(uint64_t),
+                  "The CSR index must be stored as 64-bit offsets");
+    MappedFile file(FileName);
+
+    BinaryGraphHeader header;
+    header.magic = 0;
+    if (file.size() >= sizeof(header)) {
+      std::memcpy(&header, file.data(), sizeof(header));
+      header.swap_little_endian();
+    }
+
+    if (header.magic != BinaryGraphHeader::magic_number ||
+        le64toh(uint64_t(1)) != uint64_t(1)) {
+      std::ifstream FS(FileName, std::ios::binary);
+      return Graph(FS);
+    }
+    header.validate<VertexTy, edge_type>(file.size());
+    header.validate_index(
+        reinterpret_cast<const index_type *>(file.data() + header.index_offset));
+    if (header.forward() != isForward)
+      return transposed_type::map_binary(FileName).get_transpose();
+
+    Graph G;
+    G.numNodes = header.num_nodes;
+    G.numEdges = header.num_edges;
+
+    auto reverse_map = reinterpret_cast<const VertexTy *>(
+        file.data() + header.reverse_map_offset);
+    G.reverseMap.assign(reverse_map, reverse_map + G.numNodes);
+    G.idMap = VertexIDMap<VertexTy>(G.reverseMap);
+
+    // The mapping is read-only: the CSR of a mapped graph must not be
+    // modified.
+    G.index = reinterpret_cast<index_type *>(
+        const_cast<char *>(file.data() + header.index_offset));
+    G.edges = reinterpret_cast<edge_type *>(
+        const_cast<char *>(file.data() + header.edges_offset));
+    if (header.has_lt_index())
+      G.ltIndex = reinterpret_cast<const lt_weight_type *>(
+          file.data() + header.lt_index_offset());
+    file.advise(header.index_offset, header.file_size - header.index_offset,
+                POSIX_MADV_WILLNEED);
+    G.mapping = std::move(file);
+
+    return G;
   }
 
  private:
@@ -499,8 +931,40 @@ class Graph {
   using transposed_type = Graph<vertex_type, edge_type, transposed_direction>;
 
   friend transposed_type;
+  template <typename, typename, typename>
+  friend class Graph;
 
  public:
+  //! \brief Copy the graph with another type of CSR edges.
+  //!
+  //! The vertices, their IDs and the order of the neighborhoods are kept, so
+  //! convert must preserve the order of the edges of a neighborhood.
+  //!
+  //! \tparam OutDestinationTy The type of the edges of the copy.
+  //! \tparam ConvertFn The type of the conversion function.
+  //!
+  //! \param convert Called on every edge, returns the edge of the copy.
+  //! \return the copy of the graph.
+  template <typename OutDestinationTy, typename ConvertFn>
+  Graph<VertexTy, OutDestinationTy, DirectionPolicy> convert_edges(
+      ConvertFn &&convert) const {
+    Graph<VertexTy, OutDestinationTy, DirectionPolicy> G;
+    G.numEdges = numEdges;
+    G.numNodes = numNodes;
+    G.reverseMap = reverseMap;
+    G.idMap = idMap;
+    G.index = new index_type[numNodes + 1];
+    G.edges = new OutDestinationTy[numEdges];
+
+#pragma omp parallel for
+    for (size_t i = 0; i < numNodes + 1; ++i) G.index[i] = index[i];
+
+#pragma omp parallel for
+    for (size_t i = 0; i < numEdges; ++i) G.edges[i] = convert(edges[i]);
+
+    return G;
+  }
+
   //! Get the transposed graph.
   //! \return the transposed graph.
   transposed_type get_transpose() const {
@@ -510,12 +974,12 @@ class Graph {
     G.numNodes = numNodes;
     G.reverseMap = reverseMap;
     G.idMap = idMap;
-    G.index = new out_dest_type *[numNodes + 1];
+    G.index = new index_type[numNodes + 1];
     G.edges = new out_dest_type[numEdges];
 
 #pragma omp parallel for
     for (auto itr = G.index; itr < G.index + numNodes + 1; ++itr) {
-      *itr = nullptr;
+      *itr = 0;
     }
 
 #pragma omp parallel for
@@ -523,38 +987,239 @@ class Graph {
       *itr = out_dest_type();
     }
 
-    std::for_each(edges, edges + numEdges,
-                  [&](const edge_type &d) { ++G.index[d.vertex + 1]; });
+#pragma omp parallel for
+    for (size_t i = 0; i < numEdges; ++i) {
+#pragma omp atomic
+      G.index[edges[i].vertex + 1] += 1;
+    }
 
-    G.index[0] = G.edges;
-    std::partial_sum(G.index, G.index + numNodes + 1, G.index,
-                     [](out_dest_type *a, out_dest_type *b) -> out_dest_type * {
-                       size_t sum = reinterpret_cast<size_t>(a) +
-                                    reinterpret_cast<size_t>(b);
-                       return reinterpret_cast<out_dest_type *>(sum);
-                     });
+    parallel_prefix_sum(G.index, G.index + numNodes + 1);
 
-    std::vector<out_dest_type *> destPointers(G.index, G.index + numNodes);
+    std::vector<index_type> destPointers(numNodes);
+#pragma omp parallel for
+    for (size_t v = 0; v < numNodes; ++v) destPointers[v] = G.index[v];
 
-    for (vertex_type v = 0; v < numNodes; ++v) {
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
       for (auto u : neighbors(v)) {
-        *destPointers[u.vertex] = {v, u.weight};
-        destPointers[u.vertex]++;
+        index_type position;
+#pragma omp atomic capture
+        position = destPointers[u.vertex]++;
+        out_dest_type e = u;
+        e.vertex = v;
+        G.edges[position] = e;
       }
     }
 
+    // Concurrent scatters land in any order: sorting restores the order of
+    // the sequential transpose.
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      std::sort(G.edges + G.index[v], G.edges + G.index[v + 1]);
+    }
+
     return G;
   }
 
-  edge_type **csr_index() const { return index; }
+  //! \brief Relabel the vertices of the graph.
+  //!
+  //! The CSR is rebuilt in the new vertex order and the reverse map follows
+  //! the vertices, so that convertID() still reports the original IDs.
+  //!
+  //! \param permutation The new ID of each vertex.
+  //! \return the relabeled graph.
+  Graph permute(const std::vector<vertex_type> &permutation) const {
+    Graph G;
+    G.numNodes = numNodes;
+    G.numEdges = numEdges;
+    G.index = new index_type[numNodes + 1];
+    G.edges = new edge_type[numEdges];
+    G.reverseMap.resize(numNodes);
+
+    G.index[0] = 0;
+#pragma omp parallel for
+    for (size_t v = 0; v < numNodes; ++v) {
+      G.index[permutation[v] + 1] = degree(v);
+      G.reverseMap[permutation[v]] = reverseMap[v];
+    }
+
+    parallel_prefix_sum(G.index, G.index + numNodes + 1);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      edge_type *out = G.edges + G.index[permutation[v]];
+      for (auto u : neighbors(v)) {
+        *out = u;
+        out->vertex = permutation[u.vertex];
+        ++out;
+      }
+      std::sort(G.edges + G.index[permutation[v]], out);
+    }
+
+    G.idMap = VertexIDMap<VertexTy>(G.reverseMap);
+    return G;
+  }
+
+  //! The CSR index, as offsets into the edge array.
+  index_type *csr_index() const { return index; }
 
   edge_type *csr_edges() const { return edges; }
 
  private:
+  template <typename EdgeIterator>
+  void build(EdgeIterator begin, EdgeIterator end, bool renumbering,
+             std::input_iterator_tag) {
+    using edge_list_type =
+        std::vector<typename std::iterator_traits<EdgeIterator>::value_type>;
+    edge_list_type edgeList(begin, end);
+    build(edgeList.begin(), edgeList.end(), renumbering,
+          std::random_access_iterator_tag());
+  }
+
+  //! Build the CSR in parallel from a random access edge list.
+  //!
+  //! The distinct vertex IDs are collected to build the renumbering, or only
+  //! their maximum when the IDs are kept, the degrees are counted with atomic
+  //! increments and prefix-summed into the index, and the edges are scattered
+  //! with atomic cursors.  Neighborhoods are finally sorted so that the result
+  //! does not depend on the schedule.  Besides the CSR, the temporaries scale
+  //! with the number of vertices and not with the number of edges.
+  template <typename EdgeIterator>
+  void build(EdgeIterator begin, EdgeIterator end, bool renumbering,
+             std::random_access_iterator_tag) {
+    size_t num_edges = std::distance(begin, end);
+
+    if (renumbering) {
+      reverseMap = parallel_distinct_values<VertexTy>(
+          num_edges, [&](size_t i, std::vector<VertexTy> &out) {
+            out.push_back(begin[i].source);
+            out.push_back(begin[i].destination);
+          });
+    } else {
+      size_t num_nodes = 0;
+#pragma omp parallel for reduction(max : num_nodes)
+      for (size_t i = 0; i < num_edges; ++i)
+        num_nodes = std::max<size_t>(
+            num_nodes, size_t(std::max<VertexTy>(begin[i].source,
+                                                 begin[i].destination)) +
+                           1);
+      reverseMap.resize(num_nodes);
+#pragma omp parallel for
+      for (size_t i = 0; i < reverseMap.size(); ++i) reverseMap[i] = i;
+    }
+    idMap = VertexIDMap<VertexTy>(reverseMap);
+
+    numNodes = reverseMap.size();
+    numEdges = num_edges;
+
+    index = new index_type[numNodes + 1];
+    edges = new edge_type[numEdges];
+
+#pragma omp parallel for
+    for (size_t i = 0; i < numNodes + 1; ++i) {
+      index[i] = 0;
+    }
+
+#pragma omp parallel for
+    for (size_t i = 0; i < numEdges; ++i) {
+      VertexTy source = DirectionPolicy::Source(begin + i, idMap);
+#pragma omp atomic
+      index[source + 1] += 1;
+    }
+
+    parallel_prefix_sum(index, index + numNodes + 1);
+
+    std::vector<index_type> cursor(numNodes);
+#pragma omp parallel for
+    for (size_t i = 0; i < numNodes; ++i) cursor[i] = index[i];
+
+    // The sources are looked up again rather than stored, to spare an array
+    // of the size of the edge list.
+#pragma omp parallel for
+    for (size_t i = 0; i < numEdges; ++i) {
+      VertexTy source = DirectionPolicy::Source(begin + i, idMap);
+      index_type position;
+#pragma omp atomic capture
+      position = cursor[source]++;
+      edges[position] =
+          edge_type::template Create<DirectionPolicy>(begin + i, idMap);
+    }
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      std::sort(edges + index[v], edges + index[v + 1]);
+    }
+  }
+
   template <typename FStream>
   void load_binary(FStream &FS) {
     if (!FS.is_open()) throw "Bad things happened!!!";
 
+    BinaryGraphHeader header;
+    header.magic = 0;
+    FS.read(reinterpret_cast<char *>(&header), sizeof(header));
+    header.swap_little_endian();
+
+    // Legacy dumps start directly with the number of nodes and always store
+    // forward graphs.
+    bool legacy = header.magic != BinaryGraphHeader::magic_number;
+    if (!legacy)
+      header.validate<VertexTy, edge_type>(
+          std::numeric_limits<uint64_t>::max());
+
+    if ((legacy || header.forward()) != isForward) {
+      FS.clear();
+      FS.seekg(0);
+      transposed_type G(FS);
+      *this = G.get_transpose();
+      return;
+    }
+
+    if (legacy) {
+      FS.clear();
+      FS.seekg(0);
+      load_legacy_binary(FS);
+      return;
+    }
+
+    numNodes = header.num_nodes;
+    numEdges = header.num_edges;
+
+    reverseMap.resize(numNodes);
+    FS.seekg(header.reverse_map_offset);
+    FS.read(reinterpret_cast<char *>(reverseMap.data()),
+            reverseMap.size() * sizeof(VertexTy));
+    sequence_of<VertexTy>::load(reverseMap.begin(), reverseMap.end(),
+                                reverseMap.begin());
+
+    idMap = VertexIDMap<VertexTy>(reverseMap);
+
+    index = new index_type[numNodes + 1];
+    edges = new edge_type[numEdges];
+
+    FS.seekg(header.index_offset);
+    FS.read(reinterpret_cast<char *>(index),
+            (numNodes + 1) * sizeof(index_type));
+    sequence_of<index_type>::load(index, index + numNodes + 1, index);
+    header.validate_index(index);
+
+    FS.seekg(header.edges_offset);
+    FS.read(reinterpret_cast<char *>(edges), numEdges * sizeof(edge_type));
+    sequence_of<edge_type>::load(edges, edges + numEdges, edges);
+
+    if (!header.has_lt_index()) return;
+    ltIndexStorage.resize(numEdges);
+    FS.seekg(header.lt_index_offset());
+    FS.read(reinterpret_cast<char *>(ltIndexStorage.data()),
+            numEdges * sizeof(lt_weight_type));
+    sequence_of<lt_weight_type>::load(ltIndexStorage.begin(),
+                                      ltIndexStorage.end(),
+                                      ltIndexStorage.begin());
+    ltIndex = ltIndexStorage.data();
+  }
+
+  template <typename FStream>
+  void load_legacy_binary(FStream &FS) {
     FS.read(reinterpret_cast<char *>(&numNodes), sizeof(numNodes));
     FS.read(reinterpret_cast<char *>(&numEdges), sizeof(numEdges));
 
@@ -568,14 +1233,14 @@ class Graph {
     sequence_of<VertexTy>::load(reverseMap.begin(), reverseMap.end(),
                                 reverseMap.begin());
 
-    for (VertexTy i = 0; i < numNodes; ++i) idMap[reverseMap[i]] = i;
+    idMap = VertexIDMap<VertexTy>(reverseMap);
 
-    index = new edge_type *[numNodes + 1];
+    index = new index_type[numNodes + 1];
     edges = new edge_type[numEdges];
 
     #pragma omp parallel for
     for (size_t i = 0; i < numNodes + 1; ++i) {
-      index[i] = nullptr;
+      index[i] = 0;
     }
 
     #pragma omp parallel for
@@ -583,28 +1248,69 @@ class Graph {
       edges[i] = edge_type();
     }
 
+    // The legacy format already stores the index as relative offsets.
     FS.read(reinterpret_cast<char *>(index),
             (numNodes + 1) * sizeof(ptrdiff_t));
-
-    sequence_of<edge_type *>::load(index, index + numNodes + 1, index);
-
-    std::transform(index, index + numNodes + 1, index,
-                   [=](edge_type *v) -> edge_type * {
-                     return reinterpret_cast<ptrdiff_t>(v) + edges;
-                   });
+    sequence_of<index_type>::load(index, index + numNodes + 1, index);
 
     FS.read(reinterpret_cast<char *>(edges), numEdges * sizeof(edge_type));
     sequence_of<edge_type>::load(edges, edges + numEdges, edges);
   }
 
-  edge_type **index;
-  edge_type *edges;
+  void copy_csr(const Graph &O) {
+    edges = new edge_type[numEdges];
+    index = new index_type[numNodes + 1];
+#pragma omp parallel for
+    for (size_t i = 0; i < numEdges; ++i) {
+      edges[i] = O.edges[i];
+    }
 
-  std::map<VertexTy, VertexTy> idMap;
-  std::vector<VertexTy> reverseMap;
+#pragma omp parallel for
+    for (size_t i = 0; i < numNodes + 1; ++i) {
+      index[i] = O.index[i];
+    }
+
+    if (O.has_lt_index()) {
+      ltIndexStorage.assign(O.ltIndex, O.ltIndex + numEdges);
+      ltIndex = ltIndexStorage.data();
+    }
+    icRunIndex = O.icRunIndex;
+    icRuns = O.icRuns;
+  }
+
+  void release_csr() {
+    // A mapped CSR is released together with the mapping.
+    if (!mapping.is_mapped()) {
+      delete[] index;
+      delete[] edges;
+    }
+    mapping = MappedFile();
+    index = nullptr;
+    edges = nullptr;
+    ltIndex = nullptr;
+    ltIndexStorage.clear();
+    icRunIndex.clear();
+    icRuns.clear();
+  }
 
   size_t numNodes;
   size_t numEdges;
+
+  index_type *index;
+  edge_type *edges;
+
+  VertexIDMap<VertexTy> idMap;
+  std::vector<VertexTy> reverseMap;
+
+  // Points either into ltIndexStorage or into the mapping.
+  const lt_weight_type *ltIndex;
+  std::vector<lt_weight_type> ltIndexStorage;
+
+  // The equal-weight runs of every neighborhood, see build_ic_runs.
+  std::vector<index_type> icRunIndex;
+  std::vector<EdgeRun> icRuns;
+
+  MappedFile mapping;
 };
 
 template <typename BwdGraphTy, typename FwdGraphTy>
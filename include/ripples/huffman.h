@@ -336,6 +336,46 @@ void encodeRR22(const HuffmanTree *huffmanTree, InItr in_begin, size_t length,
 }
 
 
+//! \brief Huffman-encode the i-th RRR set and clear it.
+//!
+//! The vertices with a code go to compR[i], the others are copied to
+//! copyR[i].  This is the kernel of encodeRRRSets3, and the fused sampling
+//! mode of Sampling5 calls it on each RRR set right after sampling it.
+//!
+//! \return the number of vertices of the RRR set.
+template <typename vertex_type, typename InItr>
+size_t encodeRRRSet3(const HuffmanTree* huffmanTree, InItr in_begin, size_t i,
+	std::vector<unsigned char*> &compR, std::vector<uint32_t> &compBytes, std::vector<uint32_t> &codeCnt,
+	std::vector<vertex_type*> &copyR, std::vector<uint32_t> &copyCnt, vertex_type* maxvtx) {
+    unsigned char* tmp_encode=NULL; 
+    vertex_type* tmp_encopy = NULL;
+    size_t encodeSize=0, code_cnt=0, copy_cnt=0;
+    size_t s2=std::distance(in_begin->begin(),in_begin->end());
+    tmp_encode = (unsigned char*)malloc(s2*sizeof(unsigned long));
+    memset(tmp_encode,0,s2*sizeof(unsigned long));
+    tmp_encopy = (vertex_type*)malloc(s2*sizeof(vertex_type));
+    memset(tmp_encopy,0,s2*sizeof(vertex_type));
+    encodeRR22(huffmanTree, in_begin, s2, tmp_encode, &encodeSize, &code_cnt, tmp_encopy, &copy_cnt, maxvtx);
+    if(encodeSize>=1){
+        compR[i] = (unsigned char*)malloc(encodeSize*sizeof(unsigned char));
+        memset(compR[i],0,encodeSize*sizeof(unsigned char));
+        memcpy(compR[i], tmp_encode, encodeSize*sizeof(unsigned char));
+    }
+    compBytes[i]=encodeSize;
+    codeCnt[i]=code_cnt;
+    if(copy_cnt>=1){
+        copyR[i] = (vertex_type*)malloc(copy_cnt*sizeof(vertex_type));
+        memset(copyR[i],0,copy_cnt*sizeof(vertex_type));
+    	memcpy(copyR[i], tmp_encopy, copy_cnt*sizeof(vertex_type)); 
+    }
+    copyCnt[i]=copy_cnt;
+	free(tmp_encode); 
+    free(tmp_encopy);
+    (*in_begin).clear();	//# check why block+compress is faster than original sampling
+    (*in_begin).shrink_to_fit(); //# check why block+compress is faster than original sampling
+    return s2;
+}
+
 template <typename vertex_type, typename RRRset>
 void encodeRRRSets3(const HuffmanTree* huffmanTree, std::vector<RRRset> &RRRsets, const int blockoffset,
 	std::vector<unsigned char*> &compR,	std::vector<uint32_t> &compBytes, std::vector<uint32_t> &codeCnt,
@@ -351,38 +391,12 @@ void encodeRRRSets3(const HuffmanTree* huffmanTree, std::vector<RRRset> &RRRsets
   	
 #pragma omp parallel for num_threads(num_threads) reduction(+:total_rrr_size, block_code_sum, block_copy_sum) schedule(static)  	
     for (size_t i=blockoffset; i<s1; i++) {
-        unsigned char* tmp_encode=NULL; 
-        vertex_type* tmp_encopy = NULL;
-        size_t encodeSize=0, code_cnt=0, copy_cnt=0;
         // auto in_begin=RRRsets.begin() + i;
         auto in_begin=RRRsets.begin();
         std::advance(in_begin, i);
-        size_t s2=std::distance(in_begin->begin(),in_begin->end());
-        tmp_encode = (unsigned char*)malloc(s2*sizeof(unsigned long));
-        memset(tmp_encode,0,s2*sizeof(unsigned long));
-        tmp_encopy = (vertex_type*)malloc(s2*sizeof(vertex_type));
-        memset(tmp_encopy,0,s2*sizeof(vertex_type));
-        encodeRR22(huffmanTree, in_begin, s2, tmp_encode, &encodeSize, &code_cnt, tmp_encopy, &copy_cnt, maxvtx);
-        if(encodeSize>=1){
-            compR[i] = (unsigned char*)malloc(encodeSize*sizeof(unsigned char));
-            memset(compR[i],0,encodeSize*sizeof(unsigned char));
-            memcpy(compR[i], tmp_encode, encodeSize*sizeof(unsigned char));
-        }
-        compBytes[i]=encodeSize;
-        codeCnt[i]=code_cnt;
-        if(copy_cnt>=1){
-            copyR[i] = (vertex_type*)malloc(copy_cnt*sizeof(vertex_type));
-            memset(copyR[i],0,copy_cnt*sizeof(vertex_type));
-        	memcpy(copyR[i], tmp_encopy, copy_cnt*sizeof(vertex_type)); 
-        }
-        copyCnt[i]=copy_cnt;
-		free(tmp_encode); 
-        free(tmp_encopy);
-        (*in_begin).clear();	//# check why block+compress is faster than original sampling
-        (*in_begin).shrink_to_fit(); //# check why block+compress is faster than original sampling
+        total_rrr_size += encodeRRRSet3(huffmanTree, in_begin, i, compR, compBytes, codeCnt, copyR, copyCnt, maxvtx);
         block_code_sum += codeCnt[i];
         block_copy_sum += copyCnt[i];
-        total_rrr_size += s2;
     }
 	std::cout<<" compress-block code="<<block_code_sum;
 	std::cout<<" copy="<<block_copy_sum<<" total=" <<total_rrr_size<<std::endl;
@@ -429,6 +443,9 @@ void decodeCheck(const unsigned char *s, const size_t targetLength, node t, vert
 }
 
 
+//! \param seeded The counts of the RRR sets kept out of compR, split evenly
+//! among the counters of the threads.  The caller zeroes the count of maxvtx
+//! before the call.
 template <typename vertex_type>
 vertex_type DecompAndFind4(const HuffmanTree* huffmanTree, const uint32_t tot_nodes,
                   const std::vector<unsigned char*> &compR, const std::vector<uint32_t> &codeCnt,
@@ -436,7 +453,8 @@ vertex_type DecompAndFind4(const HuffmanTree* huffmanTree, const uint32_t tot_no
                   std::vector<bool> &deleteflag,
                   const uint32_t s1, const vertex_type maxvtx, size_t *freq,
                   IMMExecutionRecord &record, 
-                  omp_parallel_tag &&ex_tag, int release_flag) {
+                  omp_parallel_tag &&ex_tag, int release_flag,
+                  const uint32_t *seeded = nullptr) {
 	// std::cout<<" >>>>>>>> mv="<<maxvtx<<" ===== "<<std::endl;
 	*freq=0;
 	size_t num_threads = omp_get_max_threads();
@@ -462,7 +480,7 @@ vertex_type DecompAndFind4(const HuffmanTree* huffmanTree, const uint32_t tot_no
         
         node hroot = huffmanTree->pool+ huffmanTree->n_nodes-1;
 
-        if(deleteflag[i]==0){
+        if(deleteflag[i]==0 && codeCnt[i]+copyCnt[i]>0){
         	decodes = (vertex_type*)malloc(codeCnt[i]*sizeof(vertex_type));
         	if(codeCnt[i]>0){
             	decodeCheck(compR[i], codeCnt[i], hroot, decodes, maxvtx, &find_flag);
@@ -496,7 +514,11 @@ vertex_type DecompAndFind4(const HuffmanTree* huffmanTree, const uint32_t tot_no
         }
     }
     int local_vtx=0, local_max=0;
+    int share=num_threads-1-omp_get_thread_num();
     for(int ii=0;ii<tot_nodes;ii++){
+        if(seeded && seeded[ii]){
+            localcnt[ii]+=(seeded[ii]+share)/num_threads;
+        }
     	local_workload+=localcnt[ii];
         if(localcnt[ii]>local_max)  {
           local_max=localcnt[ii];
@@ -43,8 +43,11 @@
 #ifndef RIPPLES_IMM_H
 #define RIPPLES_IMM_H
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <functional>
 #include <limits>
 #include <unordered_map>
 #include <vector>
@@ -55,9 +58,11 @@
 #include "trng/uniform_int_dist.hpp"
 
 #include "ripples/configuration.h"
+#include "ripples/count_statistics.h"
 #include "ripples/find_most_influential.h"
 #include "ripples/generate_rrr_sets.h"
 #include "ripples/imm_execution_record.h"
+#include "ripples/source_vertices.h"
 #include "ripples/tim.h"
 #include "ripples/utility.h"
 #include "ripples/huffman.h"
@@ -78,6 +83,15 @@ struct IMMConfiguration : public TIMConfiguration {
   size_t seed_select_max_gpu_workers{0};
   std::string gpu_mapping_string{""};
   std::unordered_map<size_t, size_t> worker_to_gpu;
+  bool dedup_rrr_sets{false};
+  bool bit_parallel_walks{false};
+  bool interleaved_lt_walks{false};
+  bool counter_rng{false};
+  size_t giant_rrr_frontier{0};
+  size_t rrr_sets_per_world{0};
+  bool fused_compression{false};
+  bool count_source_sets{false};
+  bool integer_thresholds{false};
 
   //! \brief Add command line options to configure IMM.
   //!
@@ -97,6 +111,41 @@ struct IMMConfiguration : public TIMConfiguration {
     app.add_option("--seed-select-max-gpu-workers", seed_select_max_gpu_workers,
                    "The max number of GPU workers for seed selection.")
         ->group("Streaming-Engine Options");
+    app.add_flag("--bit-parallel-walks", bit_parallel_walks,
+                 "Sample IC RRR sets on the CPU workers 64 at a time.")
+        ->group("Streaming-Engine Options");
+    app.add_flag("--interleaved-lt-walks", interleaved_lt_walks,
+                 "Advance 16 LT walks in lockstep on the CPU workers.")
+        ->group("Streaming-Engine Options");
+    app.add_flag("--counter-rng", counter_rng,
+                 "Key the random numbers of every RRR set by its index, so "
+                 "that the sets do not depend on the number of workers.")
+        ->group("Streaming-Engine Options");
+    app.add_option("--giant-rrr-frontier", giant_rrr_frontier,
+                   "Finish the IC RRR sets whose frontier grows past this "
+                   "size with a parallel BFS on all the workers (0 disables).")
+        ->group("Streaming-Engine Options");
+    app.add_option("--rrr-sets-per-world", rrr_sets_per_world,
+                   "Read this many IC RRR sets from each sampled live-edge "
+                   "world, trading their independence for speed on "
+                   "high-probability graphs (0 disables).")
+        ->group("Streaming-Engine Options");
+    app.add_flag("--fused-compression", fused_compression,
+                 "Compress each RRR set right after sampling it, once the "
+                 "HBMax encoding has been chosen.")
+        ->group("Streaming-Engine Options");
+    app.add_flag("--count-source-sets", count_source_sets,
+                 "Count the RRR sets rooted at vertices without in-edges "
+                 "instead of sampling and storing them.")
+        ->group("Streaming-Engine Options");
+    app.add_flag("--integer-thresholds", integer_thresholds,
+                 "Store the edge probabilities as 32-bit thresholds compared "
+                 "with raw random bits while sampling.")
+        ->group("Algorithm Options");
+    app.add_flag("--dedup-rrr-sets", dedup_rrr_sets,
+                 "Fold singleton and duplicate RRR sets as they are sampled "
+                 "(sequential IMM only).")
+        ->group("Algorithm Options");
   }
 };
 
@@ -153,37 +202,11 @@ inline size_t Theta(double epsilon, double l, size_t k, double LB,
 }
 
 inline auto Entropy(std::vector<uint32_t> &globalcnt, const size_t delta_block) {
-  size_t N=globalcnt.size();
-  size_t sum = 0;
-  std::for_each(globalcnt.begin(), globalcnt.end(), [&] (uint32_t x) {
-     sum += x;
-  });
-  double density = 0.0;
-  density = sum*1.0/(N*delta_block*1.0);
-  float mean = sum/N;
-  float s2 = 0;
-  std::for_each(globalcnt.begin(), globalcnt.end(), [&] (uint32_t x) {
-     s2 += pow((x-mean),2)/(N-1);
-  });
-  float s = sqrt(s2);
-  float entropy = 0.0;  
-  std::for_each(globalcnt.begin(), globalcnt.end(), [&] (uint32_t x) {
-    float p_x = (float)x/sum;
-    if(p_x>0){
-      entropy -= p_x*log2(p_x);
-    }
-  });
-  float skew = 0.0;
-  std::for_each(globalcnt.begin(), globalcnt.end(), [&] (uint32_t x) {
-     skew += pow((x-mean),3)/(N*pow(s,3));
-  });
-  float kurt = 0.0;
-  std::for_each(globalcnt.begin(), globalcnt.end(), [&] (uint32_t x) {
-     kurt += pow((x-mean),4)/(N*pow(s,4));
-  });
-  kurt-=3; //
-  std::cout<<"sum="<<sum<<" N="<<N<<" delta--block="<<delta_block<<" density="<<density<<std::endl;
-  return std::make_tuple(entropy,skew,kurt,density);
+  CountStatistics stats;
+  for (auto x : globalcnt) stats.add(x);
+  auto summary = stats.summary(delta_block);
+  std::cout<<"sum="<<size_t(stats.sum)<<" N="<<stats.num_vertices<<" delta--block="<<delta_block<<" density="<<std::get<3>(summary)<<std::endl;
+  return summary;
 }
 //! Collect a set of Random Reverse Reachable set.
 //!
@@ -223,7 +246,7 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
   #else
   RRRsetAllocator<vertex_type> allocator;
   #endif
-  std::vector<RRRset<GraphTy>> RR;
+  RRRsetStore<GraphTy> RR(allocator);
 
   auto xc1 = spdlog::stdout_color_st("xc1:");
 
@@ -256,6 +279,12 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
   size_t thetaPrime = 0;
 
   int create_flag = 1, dense_flag=0, skew_flag=0;
+  CountStatistics count_stats;
+  // Without --count-source-sets no vertex is a source and the seeded counts
+  // of the selection stay zero.
+  SourceVertices sources(G, CFG.count_source_sets);
+  std::vector<uint32_t> seeded;
+  if (CFG.count_source_sets) generator.count_sources(&sources);
   std::vector<bool> deleteflag;
   vertex_type tmpmax=0, nxtmax=0;
   size_t uncovered=0, freq=0;
@@ -264,6 +293,93 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
   double total_sampling=0, total_encode=0, total_decode, total_tree=0;
   float time_sample=0.0, time_encode=0.0, time_select=0.0;
 
+  // Allocate the compressed form of the RRR sets of round x.
+  BitmapColumns bitmap_columns;
+  auto allocate_round = [&](ssize_t x, size_t thetaPrime) {
+    if (skew_flag ==1){
+      compR.resize(thetaPrime);
+      compBytes.resize(thetaPrime);
+      codeCnt.resize(thetaPrime);
+      copyR.resize(thetaPrime);
+      copyCnt.resize(thetaPrime);
+    }
+    else { //skew-flag == 0
+      blockR1_pointer.resize(x);
+      blockR1.resize(x);
+      blockR1_bkp.resize(x);
+      blockR1_pointer[x-1].resize(num_threads);
+      blockR1[x-1].resize(num_threads);
+      blockR1_bkp[x-1].resize(num_threads);
+      deleteVtx.resize(num_threads); 
+      #pragma omp parallel for num_threads(num_threads)
+      for(int r=0;r<num_threads;r++){
+          blockR1_pointer[x-1][r]=0;
+          blockR1[x-1][r]=(unsigned int*)calloc((n_ints1[x-1])*n_rows,sizeof(unsigned int));
+          blockR1_bkp[x-1][r]=(unsigned int*)calloc((n_ints1[x-1])*n_rows,sizeof(unsigned int));
+          deleteVtx[r]=(bool*)calloc(n_rows,sizeof(bool));
+      }
+      bitmap_columns.reset(&blockR1[x-1], n_ints1[x-1]);
+      std::cout<< " x="<< x<<" blockR1.size="<<blockR1.size();
+      std::cout<< " blockR1[x-0].size=" << blockR1[0].size() << std::endl;
+    }
+  };
+
+  // Encode the RRR sets of a chunk in the form chosen on the warm-up block.
+  // The slots of the deferred giant samples are still empty: they come later.
+  using rrr_iterator = decltype(RR.begin());
+  auto encode_chunk = [&](rrr_iterator first, rrr_iterator last) {
+    size_t index = first - RR.begin();
+    auto sets = RR.sets().begin() + index;
+    auto sets_end = sets + (last - first);
+    if (skew_flag == 1) {
+      for (auto itr = sets; itr != sets_end; ++itr)
+        if (!itr->empty())
+          encodeRRRSet3<vertex_type>(huffmanTree, itr, index + (itr - sets),
+                                     compR, compBytes, codeCnt, copyR, copyCnt,
+                                     maxvtx);
+    } else {
+      size_t column = bitmap_columns.reserve(std::count_if(
+          sets, sets_end, [](const typename decltype(RR)::value_type &set) {
+            return !set.empty();
+          }));
+      for (auto itr = sets; itr != sets_end; ++itr) {
+        if (itr->empty()) continue;
+        bitmap_columns.encode(*itr, column++);
+        itr->clear();
+      }
+    }
+  };
+  // The singletons of the vertices without in-edges are counted, not stored:
+  // their slots stay empty and the selection pre-seeds its counters.  The
+  // scalar CPU workers skip these roots before sampling them; the sink counts
+  // the singletons sampled by the other kernels.
+  auto count_sources = [&](rrr_iterator first, rrr_iterator last) {
+    if (!CFG.count_source_sets) return;
+    auto sets = RR.sets().begin() + (first - RR.begin());
+    auto sets_end = sets + (last - first);
+    for (auto itr = sets; itr != sets_end; ++itr)
+      if (sources.absorb(*itr)) itr->clear();
+  };
+  // The fused mode encodes the chunks on the thread that sampled them, which
+  // then reuses its arena: the block never exists in uncompressed form.
+  // Rewinding is safe because the generator hands every set to the sink right
+  // after storing it, on the storing thread: the arena of this thread holds
+  // only this chunk and chunks already encoded and cleared.
+  std::function<void(rrr_iterator, rrr_iterator)> source_sink;
+  if (CFG.count_source_sets) source_sink = count_sources;
+  std::function<void(rrr_iterator, rrr_iterator)> fused_sink =
+      [&](rrr_iterator first, rrr_iterator last) {
+        count_sources(first, last);
+        encode_chunk(first, last);
+        auto sets = RR.sets().begin() + (first - RR.begin());
+        assert(std::all_of(sets, sets + (last - first),
+                           [](const typename decltype(RR)::value_type &set) {
+                             return set.empty();
+                           }));
+        (void)sets;
+        RR.rewind();
+      };
+
   float final_cover = 0.0;
   for (ssize_t x = 1; x < std::log2(G.num_nodes()); ++x) {
     // Equation 9
@@ -290,16 +406,20 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
     std::cout<<"x="<<x<<" delta="<<delta<<" n-cols="<<n_cols<<" n-ints1="<<n_ints1[x-1]<<std::endl;
     for(int i=0;i<blocks;i++){
       delta_block = delta/blocks; 
+      bool fused = CFG.fused_compression && create_flag == 0;
+      if (i==0 && fused) allocate_round(x, thetaPrime);
       auto t0 = std::chrono::high_resolution_clock::now();
       auto timeRRRSets = measure<>::exec_time([&]() {
-        RR.insert(RR.end(), delta_block, RRRset<GraphTy>(allocator));
+        RR.extend(delta_block);
 
         auto begin = RR.end() - delta_block;
 
         GenerateRRRSets2(G, generator, begin, RR.end(), record,
                         std::forward<diff_model_tag>(model_tag),
                         std::forward<execution_tag>(ex_tag),
-                        globalcnt, maxvtx);
+                        globalcnt, maxvtx,
+                        create_flag == 1 ? &count_stats : nullptr,
+                        fused ? fused_sink : source_sink);
       });
       record.ThetaEstimationGenerateRRR.push_back(timeRRRSets);
       auto t1 = std::chrono::high_resolution_clock::now();
@@ -310,7 +430,7 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
       if (create_flag==1){
         create_flag = 0;
         auto t3_1 = std::chrono::high_resolution_clock::now();
-        auto stats = Entropy(globalcnt,delta_block);
+        auto stats = count_stats.summary(delta_block);
         auto t3_2 = std::chrono::high_resolution_clock::now();
         elapse=t3_2-t3_1;
         std::cout<<" block-entropy="<<std::get<0>(stats)<<", skewness="<<std::get<1>(stats);
@@ -325,7 +445,7 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
         if(skew_flag==1){
           auto t2 = std::chrono::high_resolution_clock::now();
           process_mem_usage(vm1);
-          initByRRRSets3<vertex_type>(huffmanTree, RR);
+          initByRRRSets3<vertex_type>(huffmanTree, RR.sets());
           process_mem_usage(vm2);
           auto t3 = std::chrono::high_resolution_clock::now();
           elapse=t3-t2;
@@ -347,47 +467,38 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
           std::cout<<"maxlen="<<maxlen<<", maxc="<<maxc<<" minlen="<<minlen<<", minc="<<minc<<std::endl;
         }
       }
-      if (i==0) {
-        if (skew_flag ==1){
-          compR.resize(thetaPrime);
-          compBytes.resize(thetaPrime);
-          codeCnt.resize(thetaPrime);
-          copyR.resize(thetaPrime);
-          copyCnt.resize(thetaPrime);
-        }
-        else { //skew-flag == 0
-          blockR1_pointer.resize(x);
-          blockR1.resize(x);
-          blockR1_bkp.resize(x);
-          blockR1_pointer[x-1].resize(num_threads);
-          blockR1[x-1].resize(num_threads);
-          blockR1_bkp[x-1].resize(num_threads);
-          deleteVtx.resize(num_threads); 
-          #pragma omp parallel for num_threads(num_threads)
-          for(int r=0;r<num_threads;r++){
-              blockR1_pointer[x-1][r]=0;
-              blockR1[x-1][r]=(unsigned int*)calloc((n_ints1[x-1])*n_rows,sizeof(unsigned int));
-              blockR1_bkp[x-1][r]=(unsigned int*)calloc((n_ints1[x-1])*n_rows,sizeof(unsigned int));
-              deleteVtx[r]=(bool*)calloc(n_rows,sizeof(bool));
-          }
-          std::cout<< " x="<< x<<" blockR1.size="<<blockR1.size();
-          std::cout<< " blockR1[x-0].size=" << blockR1[0].size() << std::endl;
-        }
+      if (i==0 && !fused) allocate_round(x, thetaPrime);
+      if (fused) {
+        elapse = ex_time_ms::zero();
       }
-      if(skew_flag==1){ //skew > 0
+      else if (CFG.fused_compression) {
+        // The warm-up block goes through the kernel of the fused blocks, so
+        // that they share the bitmap columns.
         auto t4 = std::chrono::high_resolution_clock::now();
-        encodeRRRSets3<vertex_type>(huffmanTree, RR, delta_block_sum, compR, compBytes, codeCnt, copyR, copyCnt, globalcnt, maxvtx);
+        auto begin = RR.end() - delta_block;
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+        for (int j = 0; j < delta_block; j += 1024)
+          encode_chunk(begin + j, begin + std::min(j + 1024, delta_block));
+        auto t5 = std::chrono::high_resolution_clock::now();
+        elapse=t5-t4;
+        std::cout<<" compress-block.time=("<<elapse.count()<<")ms"<<std::endl;
+      }
+      else if(skew_flag==1){ //skew > 0
+        auto t4 = std::chrono::high_resolution_clock::now();
+        encodeRRRSets3<vertex_type>(huffmanTree, RR.sets(), delta_block_sum, compR, compBytes, codeCnt, copyR, copyCnt, globalcnt, maxvtx);
         auto t5 = std::chrono::high_resolution_clock::now();
         elapse=t5-t4;
         std::cout<<" compress-block.time=("<<elapse.count()<<")ms"<<std::endl;
       }
       else{  //also dense_flag==1 density > 3%
         auto t1_0 = std::chrono::high_resolution_clock::now();
-        bitmapRRRSets0<vertex_type>(RR, delta_block_sum, blockR1_pointer[x-1], blockR1[x-1], n_ints1[x-1]);
+        bitmapRRRSets0<vertex_type>(RR.sets(), delta_block_sum, blockR1_pointer[x-1], blockR1[x-1], n_ints1[x-1]);
         auto t1_1 = std::chrono::high_resolution_clock::now();
         elapse=t1_1-t1_0;
       }
       time_encode += elapse.count();
+      // The block now lives in its encoded form.
+      RR.release();
       delta_block_sum += delta_block;
     }
     
@@ -399,18 +510,22 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
         }
         uncovered=compR.size();
         tmpmax = *maxvtx;
+        seeded = sources.counts();
         auto t6 = std::chrono::high_resolution_clock::now();
         while(seeds.size() < CFG.k && uncovered != 0){
           seeds.push_back(tmpmax);  
+          size_t seeded_freq = seeded[tmpmax];
+          seeded[tmpmax] = 0;
           auto t6_1 = std::chrono::high_resolution_clock::now();  
           nxtmax = DecompAndFind4<vertex_type>(huffmanTree, G.num_nodes(),
                   compR, codeCnt, copyR, copyCnt, deleteflag, 
                   compR.size(), tmpmax, &freq,
-                  record, std::forward<omp_parallel_tag>(ex_tag), 0);
+                  record, std::forward<omp_parallel_tag>(ex_tag), 0,
+                  seeded.data());
           auto t6_2 = std::chrono::high_resolution_clock::now();
           elapse=t6_2-t6_1;
           // std::cout<<" decomp:tmpmax("<<tmpmax<<") freq="<<freq<<" using="<<elapse.count()<<"ms"<<std::endl;
-          uncovered-=freq;
+          uncovered-=freq+seeded_freq;
           tmpmax=nxtmax;
           f = double(compR.size() - uncovered) / compR.size();
         }
@@ -422,13 +537,15 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
       else{ // also density > 3%
         uncovered = delta_block_sum; 
         auto t1_2 = std::chrono::high_resolution_clock::now();
-        countRR0(blockR1, G.num_nodes(), n_ints1, local_m1, local_v1, maxk, maxv);
+        seeded = sources.counts();
+        countRR0(blockR1, G.num_nodes(), n_ints1, local_m1, local_v1, maxk, maxv, seeded.data());
         auto t1_3 = std::chrono::high_resolution_clock::now();
         while(seeds.size() < CFG.k && uncovered != 0){
           seeds.push_back(maxk);
           uncovered -= maxv;
+          seeded[maxk] = 0;
           f = double(delta_block_sum - uncovered) / delta_block_sum;
-          selectRR20(blockR1,  G.num_nodes(), n_ints1, local_m1, local_v1, deleteVtx, maxk, maxv);
+          selectRR20(blockR1,  G.num_nodes(), n_ints1, local_m1, local_v1, deleteVtx, maxk, maxv, seeded.data());
         }
         
         auto t1_4 = std::chrono::high_resolution_clock::now();
@@ -491,50 +608,58 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
       for(int i=0;i<blocks;i++){
         // delta_block = final_delta%blocks==0? final_delta/blocks : final_delta/blocks+1;  
         delta_block = final_delta/blocks;  
+        if(i==0){
+          if(skew_flag==1){
+            compR.resize(theta);
+            compBytes.resize(theta);
+            codeCnt.resize(theta);
+            copyR.resize(theta);
+            copyCnt.resize(theta);
+          }
+          else{
+            blockR2_pointer.resize(num_threads);
+            blockR2.resize(num_threads);
+            #pragma omp parallel for num_threads(num_threads)
+            for(int r=0;r<num_threads;r++){
+                blockR2_pointer[r]=0;
+                blockR2[r]=(unsigned int*)calloc((n_ints2)*n_rows,sizeof(unsigned int));
+            }
+            bitmap_columns.reset(&blockR2, n_ints2);
+            std::cout<< " i="<< i << " blockR2[thread-0].size=" << n_cols << std::endl;
+          }
+        }
       
-        RR.insert(RR.end(), delta_block, RRRset<GraphTy>(allocator));
+        RR.extend(delta_block);
 
         auto begin = RR.end() - delta_block;
         auto t10 = std::chrono::high_resolution_clock::now();
         GenerateRRRSets2(G, generator, begin, RR.end(), record,
                         std::forward<diff_model_tag>(model_tag),
                         std::forward<execution_tag>(ex_tag),
-                        globalcnt, maxvtx);
+                        globalcnt, maxvtx, nullptr,
+                        CFG.fused_compression ? fused_sink : source_sink);
         std::cout<<" extra-here";
         auto t11 = std::chrono::high_resolution_clock::now();
         elapse=t11-t10;
         time_sample += elapse.count();
         std::cout<<" extra-gen-block.time=("<<elapse.count()<<")ms"<<std::endl;
-        if(skew_flag==1){
-          if(i==0){
-            compR.resize(theta);
-            compBytes.resize(theta);
-            codeCnt.resize(theta);
-            copyR.resize(theta);
-            copyCnt.resize(theta);
-          }
-          encodeRRRSets3<vertex_type>(huffmanTree, RR, delta_block_sum, compR, compBytes, codeCnt, copyR, copyCnt, globalcnt, maxvtx);
+        if(CFG.fused_compression){
+          // The block was encoded as it was sampled.
+        }
+        else if(skew_flag==1){
+          encodeRRRSets3<vertex_type>(huffmanTree, RR.sets(), delta_block_sum, compR, compBytes, codeCnt, copyR, copyCnt, globalcnt, maxvtx);
           auto t12 = std::chrono::high_resolution_clock::now();
           elapse=t12-t11;
           std::cout<<" extra-compress-block.time=("<<elapse.count()<<")ms"<<std::endl;
         }
         else{
-          if(i==0){
-            blockR2_pointer.resize(num_threads);
-            blockR2.resize(num_threads);
-            #pragma omp parallel for num_threads(num_threads)
-            for(int r=0;r<num_threads;r++){
-                blockR2_pointer[r]=0;
-                blockR2[r]=(unsigned int*)calloc((n_ints2)*n_rows,sizeof(unsigned int));
-            }
-            std::cout<< " i="<< i << " blockR2[thread-0].size=" << n_cols << std::endl;
-          }
           auto t12_0 = std::chrono::high_resolution_clock::now();
-          bitmapRRRSets0<vertex_type>(RR, delta_block_sum, blockR2_pointer, blockR2, n_ints2);
+          bitmapRRRSets0<vertex_type>(RR.sets(), delta_block_sum, blockR2_pointer, blockR2, n_ints2);
           auto t12_1 = std::chrono::high_resolution_clock::now();
           elapse=t12_1-t12_0;
           time_encode += elapse.count();
         }
+        RR.release();
         delta_block_sum += delta_block;
       }
       seeds.clear();
@@ -546,20 +671,24 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
         }
         uncovered=theta;
         tmpmax = *maxvtx;
+        seeded = sources.counts();
 
         auto t8 = std::chrono::high_resolution_clock::now();
 
         while(seeds.size() < CFG.k && uncovered != 0){
           seeds.push_back(tmpmax);  
+          size_t seeded_freq = seeded[tmpmax];
+          seeded[tmpmax] = 0;
           auto t8_1 = std::chrono::high_resolution_clock::now();
           nxtmax = DecompAndFind4<vertex_type>(huffmanTree, G.num_nodes(),
                   compR, codeCnt, copyR, copyCnt, deleteflag, 
                   theta, tmpmax, &freq,
-                  record, std::forward<omp_parallel_tag>(ex_tag), 1);
+                  record, std::forward<omp_parallel_tag>(ex_tag), 1,
+                  seeded.data());
           auto t8_2 = std::chrono::high_resolution_clock::now();
           elapse=t8_2-t8_1;
-          std::cout<<" extra-decomp:tmpmax("<<tmpmax<<") freq="<<freq<<" using="<<elapse.count()<<"ms"<<std::endl;
-          uncovered-=freq;
+          std::cout<<" extra-decomp:tmpmax("<<tmpmax<<") freq="<<freq+seeded_freq<<" using="<<elapse.count()<<"ms"<<std::endl;
+          uncovered-=freq+seeded_freq;
           tmpmax=nxtmax;
           f = double(theta - uncovered) / theta;
         }
@@ -592,13 +721,15 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
         }
         uncovered = delta_block_sum;
         auto t6_2 = std::chrono::high_resolution_clock::now();
-        countRR02(blockR1, blockR2, G.num_nodes(), n_ints1, n_ints2, local_m1, local_v1, maxk, maxv);
+        seeded = sources.counts();
+        countRR02(blockR1, blockR2, G.num_nodes(), n_ints1, n_ints2, local_m1, local_v1, maxk, maxv, seeded.data());
         auto t6_3 = std::chrono::high_resolution_clock::now();
         while(seeds.size() < CFG.k && uncovered != 0){
           seeds.push_back(maxk);
           uncovered -= maxv;
+          seeded[maxk] = 0;
           f = double(delta_block_sum - uncovered) / delta_block_sum;
-          selectRR202(blockR1, blockR2, G.num_nodes(), n_ints1, n_ints2, local_m1, local_v1, deleteVtx, maxk, maxv);
+          selectRR202(blockR1, blockR2, G.num_nodes(), n_ints1, n_ints2, local_m1, local_v1, deleteVtx, maxk, maxv, seeded.data());
           std::cout<<"## select="<<seeds.size()<<" maxk="<<maxk<<" maxv="<<maxv<<" f="<<f<<std::endl;
         }
         auto t6_4 = std::chrono::high_resolution_clock::now();
@@ -628,6 +759,7 @@ auto Sampling5(HuffmanTree* huffmanTree, std::vector<uint32_t> &globalcnt,
   }
   std::cout<<" *** generate: rr.size:"<<RR.size()<<" compr.size="<<compR.size()<<" theta:"<<theta<<std::endl;
   std::cout<<", total-encode="<<total_encode<<" total_decode="<<total_decode<<std::endl;
+  generator.count_sources(nullptr);
   return seeds;
 }
 
@@ -748,11 +880,17 @@ auto Sampling(const GraphTy &G, const ConfTy &CFG, double l,
   return RR;
 }
 
+//! \brief Sample the RRR sets of the sequential IMM.
+//!
+//! \param folded If not null, the sets are folded into it a batch at a time
+//! as they are sampled, and the returned store is left empty: the
+//! undeduplicated sets never exist all at once.
 template <typename GraphTy, typename ConfTy, typename RRRGeneratorTy,
           typename diff_model_tag>
 auto Sampling(const GraphTy &G, const ConfTy &CFG, double l,
               RRRGeneratorTy &generator, IMMExecutionRecord &record,
-              diff_model_tag &&model_tag, sequential_tag &&ex_tag) {
+              diff_model_tag &&model_tag, sequential_tag &&ex_tag,
+              WeightedRRRsets<RRRset<GraphTy>> *folded = nullptr) {
   using vertex_type = typename GraphTy::vertex_type;
   size_t k = CFG.k;
   double epsilon = CFG.epsilon;
@@ -766,39 +904,58 @@ auto Sampling(const GraphTy &G, const ConfTy &CFG, double l,
   #else
   RRRsetAllocator<vertex_type> allocator;
   #endif
-  std::vector<RRRset<GraphTy>> RR;
+  RRRsetStore<GraphTy> RR(allocator);
 
   auto xc2 = spdlog::stdout_color_st("xc2:");
   xc2->info("$$$ sampling 2");
 
+  // Sample delta more sets, into RR or folded.
+  auto generate = [&](size_t delta) {
+    if (!folded) {
+      RR.extend(delta);
+      auto begin = RR.end() - delta;
+      GenerateRRRSets2(G, generator, begin, RR.end(), record,
+                       std::forward<diff_model_tag>(model_tag),
+                       std::forward<sequential_tag>(ex_tag));
+      return;
+    }
+    constexpr size_t batch_size = size_t(1) << 16;
+    for (size_t done = 0; done < delta; done += batch_size) {
+      RR.extend(std::min(batch_size, delta - done));
+      GenerateRRRSets2(G, generator, RR.begin(), RR.end(), record,
+                       std::forward<diff_model_tag>(model_tag),
+                       std::forward<sequential_tag>(ex_tag));
+      folded->insert_sets(RR.sets().begin(), RR.sets().end());
+      RR.sets().clear();
+      RR.rewind();
+    }
+  };
+  auto num_sets = [&]() { return folded ? folded->size() : RR.size(); };
+
   auto start = std::chrono::high_resolution_clock::now();
   size_t thetaPrime = 0;
   for (ssize_t x = 1; x < std::log2(G.num_nodes()); ++x) {
     // Equation 9
     ssize_t thetaPrime = ThetaPrime(x, epsilonPrime, l, k, G.num_nodes(),
                                     std::forward<sequential_tag>(ex_tag));
-    xc2->info("$$$ theta-prime={:5d}, rr-size={:5d}",thetaPrime, RR.size());
-    size_t delta = thetaPrime - RR.size();
+    xc2->info("$$$ theta-prime={:5d}, rr-size={:5d}",thetaPrime, num_sets());
+    size_t delta = thetaPrime - num_sets();
     record.ThetaPrimeDeltas.push_back(delta);
 
-    auto timeRRRSets = measure<>::exec_time([&]() {
-      RR.insert(RR.end(), delta, RRRset<GraphTy>(allocator));
-
-      auto begin = RR.end() - delta;
-
-      GenerateRRRSets2(G, generator, begin, RR.end(), record,
-                      std::forward<diff_model_tag>(model_tag),
-                      std::forward<sequential_tag>(ex_tag));
-    });
+    auto timeRRRSets = measure<>::exec_time([&]() { generate(delta); });
     record.ThetaEstimationGenerateRRR.push_back(timeRRRSets);
 
     double f;
 
     auto timeMostInfluential = measure<>::exec_time([&]() {
-      const auto &S = FindMostInfluentialSet(
-          G, CFG, RR, record, false, std::forward<sequential_tag>(ex_tag));
-
-      f = S.first;
+      if (folded)
+        f = FindMostInfluentialSet(G, CFG, *folded, record, false,
+                                   std::forward<sequential_tag>(ex_tag))
+                .first;
+      else
+        f = FindMostInfluentialSet(G, CFG, RR, record, false,
+                                   std::forward<sequential_tag>(ex_tag))
+                .first;
     });
 
     record.ThetaEstimationMostInfluential.push_back(timeMostInfluential);
@@ -817,16 +974,7 @@ auto Sampling(const GraphTy &G, const ConfTy &CFG, double l,
   record.Theta = theta;
 
   record.GenerateRRRSets = measure<>::exec_time([&]() {
-    if (theta > RR.size()) {
-      size_t final_delta = theta - RR.size();
-      RR.insert(RR.end(), final_delta, RRRset<GraphTy>(allocator));
-
-      auto begin = RR.end() - final_delta;
-
-      GenerateRRRSets2(G, generator, begin, RR.end(), record,
-                      std::forward<diff_model_tag>(model_tag),
-                      std::forward<sequential_tag>(ex_tag));
-    }
+    if (theta > num_sets()) generate(theta - num_sets());
   });
 
   return RR;
@@ -858,20 +1006,30 @@ auto IMM(const GraphTy &G, const ConfTy &CFG, double l, PRNG &gen,
 
   l = l * (1 + 1 / std::log2(G.num_nodes()));
 
+  // With --dedup-rrr-sets the sets are folded into WR as they are sampled
+  // and R stays empty.
+  WeightedRRRsets<RRRset<GraphTy>> WR(G.num_nodes());
   auto R = Sampling(G, CFG, l, generator, record,
                     std::forward<diff_model_tag>(model_tag),
-                    std::forward<sequential_tag>(ex_tag));
+                    std::forward<sequential_tag>(ex_tag),
+                    CFG.dedup_rrr_sets ? &WR : nullptr);
 
 #if CUDA_PROFILE
   auto logst = spdlog::stdout_color_st("IMM-profile");
   std::vector<size_t> rrr_sizes;
-  for (auto &rrr_set : R) rrr_sizes.push_back(rrr_set.size());
+  for (auto &rrr_set : R.sets()) rrr_sizes.push_back(rrr_set.size());
   print_profile_counter(logst, rrr_sizes, "RRR sizes");
 #endif
   
   auto start = std::chrono::high_resolution_clock::now();
-  const auto &S = FindMostInfluentialSet(G, CFG, R, record, false,
-                                         std::forward<sequential_tag>(ex_tag));
+  std::pair<double, std::vector<vertex_type>> S;
+  if (CFG.dedup_rrr_sets) {
+    S = FindMostInfluentialSet(G, CFG, WR, record, false,
+                               std::forward<sequential_tag>(ex_tag));
+  } else {
+    S = FindMostInfluentialSet(G, CFG, R, record, false,
+                               std::forward<sequential_tag>(ex_tag));
+  }
   auto end = std::chrono::high_resolution_clock::now();
 
   record.FindMostInfluentialSet = end - start;
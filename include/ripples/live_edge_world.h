@@ -0,0 +1,234 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_LIVE_EDGE_WORLD_H
+#define RIPPLES_LIVE_EDGE_WORLD_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "ripples/rrr_sort.h"
+#include "ripples/sampling_scratch.h"
+
+namespace ripples {
+
+//! \brief A live-edge realization of an IC graph, condensed into its DAG of
+//! strongly connected components.
+//!
+//! Under the IC model the RRR set of a root is the set of vertices that reach
+//! it through live edges.  Sampling the liveness of every edge once gives a
+//! world from which the RRR sets of many roots are read by traversing the
+//! condensation, visiting every strongly connected component once however
+//! large it is.
+//!
+//! Each RRR set read from a world has the distribution of an independently
+//! sampled one, so the coverage of a seed set estimated on them is still
+//! unbiased.  The sets of the same world are however correlated: the
+//! concentration bounds that IMM uses to size theta assume independent
+//! samples, and the more sets are read from a world, the more the
+//! approximation guarantee is weakened in practice.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+template <typename VertexTy>
+class LiveEdgeWorld {
+ public:
+  //! \brief Build the world from the live in-edges of every vertex.
+  //!
+  //! \param num_nodes The number of vertices of the graph.
+  //! \param live_in_edges Called as live_in_edges(v, add) for every vertex v,
+  //! it calls add(u) on each live in-neighbor u of v.
+  template <typename LiveInEdgesFn>
+  void build(size_t num_nodes, LiveInEdgesFn &&live_in_edges) {
+    edge_index_.resize(num_nodes + 1);
+    edges_.clear();
+    for (size_t v = 0; v < num_nodes; ++v) {
+      edge_index_[v] = edges_.size();
+      live_in_edges(VertexTy(v), [&](VertexTy u) { edges_.push_back(u); });
+    }
+    edge_index_[num_nodes] = edges_.size();
+
+    find_components(num_nodes);
+    condense(num_nodes);
+  }
+
+  //! The number of strongly connected components of the world.
+  size_t num_components() const { return member_index_.size() - 1; }
+
+  //! \brief The RRR set of a root in this world.
+  //!
+  //! \param root The root of the RRR set.
+  //! \param result The vertices of the RRR set, sorted.
+  void rrr_set(VertexTy root, std::vector<VertexTy> &result) {
+    reached_.reset(component_.size());
+    result.clear();
+    uint32_t c = component_[root];
+    reached_.insert(c);
+    stack_.assign(1, c);
+    while (!stack_.empty()) {
+      c = stack_.back();
+      stack_.pop_back();
+      result.insert(result.end(), members_.begin() + member_index_[c],
+                    members_.begin() + member_index_[c + 1]);
+      for (size_t e = dag_index_[c]; e < dag_index_[c + 1]; ++e) {
+        uint32_t d = dag_edges_[e];
+        if (reached_[d]) continue;
+        reached_.insert(d);
+        stack_.push_back(d);
+      }
+    }
+    SortRRRSet(result.begin(), result.end(), sort_buffer_,
+               [&](VertexTy v) { return reached_[component_[v]]; });
+  }
+
+ private:
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  //! Tarjan's algorithm, with an explicit stack.  Components are numbered in
+  //! reverse topological order of the condensation.
+  void find_components(size_t num_nodes) {
+    component_.assign(num_nodes, none);
+    order_.assign(num_nodes, 0);
+    low_.resize(num_nodes);
+    uint32_t next_order = 0, next_component = 0;
+    for (size_t s = 0; s < num_nodes; ++s) {
+      if (order_[s] != 0) continue;
+      order_[s] = low_[s] = ++next_order;
+      open_.push_back(VertexTy(s));
+      calls_.emplace_back(VertexTy(s), edge_index_[s]);
+      while (!calls_.empty()) {
+        VertexTy v = calls_.back().first;
+        size_t &e = calls_.back().second;
+        if (e != edge_index_[v + 1]) {
+          VertexTy u = edges_[e++];
+          if (order_[u] == 0) {
+            order_[u] = low_[u] = ++next_order;
+            open_.push_back(u);
+            calls_.emplace_back(u, edge_index_[u]);
+          } else if (component_[u] == none) {
+            low_[v] = std::min(low_[v], order_[u]);
+          }
+          continue;
+        }
+        calls_.pop_back();
+        if (low_[v] == order_[v]) {
+          VertexTy u;
+          do {
+            u = open_.back();
+            open_.pop_back();
+            component_[u] = next_component;
+          } while (u != v);
+          ++next_component;
+        }
+        if (!calls_.empty()) {
+          VertexTy parent = calls_.back().first;
+          low_[parent] = std::min(low_[parent], low_[v]);
+        }
+      }
+    }
+    member_index_.assign(next_component + 1, 0);
+  }
+
+  //! Group the vertices by component and build the edges of the DAG.
+  void condense(size_t num_nodes) {
+    size_t num_components = member_index_.size() - 1;
+    for (size_t v = 0; v < num_nodes; ++v) ++member_index_[component_[v] + 1];
+    for (size_t c = 0; c < num_components; ++c)
+      member_index_[c + 1] += member_index_[c];
+    members_.resize(num_nodes);
+    order_.assign(member_index_.begin(), member_index_.end() - 1);
+    for (size_t v = 0; v < num_nodes; ++v)
+      members_[order_[component_[v]]++] = VertexTy(v);
+
+    dag_index_.resize(num_components + 1);
+    dag_edges_.clear();
+    low_.assign(num_components, none);
+    for (uint32_t c = 0; c < num_components; ++c) {
+      dag_index_[c] = dag_edges_.size();
+      for (size_t m = member_index_[c]; m < member_index_[c + 1]; ++m) {
+        VertexTy v = members_[m];
+        for (size_t e = edge_index_[v]; e < edge_index_[v + 1]; ++e) {
+          uint32_t d = component_[edges_[e]];
+          if (d == c || low_[d] == c) continue;
+          low_[d] = c;
+          dag_edges_.push_back(d);
+        }
+      }
+    }
+    dag_index_[num_components] = dag_edges_.size();
+  }
+
+  //! The live in-edges of the vertices, in CSR form.
+  std::vector<size_t> edge_index_;
+  std::vector<VertexTy> edges_;
+
+  //! The component of every vertex, and the vertices of every component.
+  std::vector<uint32_t> component_;
+  std::vector<size_t> member_index_;
+  std::vector<VertexTy> members_;
+
+  //! The edges of the condensation, towards the components reaching a
+  //! component.
+  std::vector<size_t> dag_index_;
+  std::vector<uint32_t> dag_edges_;
+
+  //! The scratch of the construction, reused across worlds.
+  std::vector<uint32_t> order_;
+  std::vector<uint32_t> low_;
+  std::vector<VertexTy> open_;
+  std::vector<std::pair<VertexTy, size_t>> calls_;
+
+  //! The scratch of the traversals.
+  EpochVisitedSet<uint32_t> reached_;
+  std::vector<uint32_t> stack_;
+  std::vector<VertexTy> sort_buffer_;
+};
+
+template <typename VertexTy>
+constexpr uint32_t LiveEdgeWorld<VertexTy>::none;
+
+}  // namespace ripples
+
+#endif /* RIPPLES_LIVE_EDGE_WORLD_H */
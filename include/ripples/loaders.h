@@ -44,17 +44,24 @@
 #define RIPPLES_LOADERS_H
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <numeric>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
+
+#include <omp.h>
 
 #include "ripples/diffusion_simulation.h"
 #include "ripples/graph.h"
+#include "ripples/mapped_file.h"
+#include "ripples/reordering.h"
+#include "ripples/utility.h"
 #include "trng/lcg64.hpp"
 #include "trng/truncated_normal_dist.hpp"
 #include "trng/uniform01_dist.hpp"
@@ -68,6 +75,196 @@ struct weighted_edge_list_tsv {};
 
 namespace {
 
+//! The size of the byte ranges in which text inputs are split.  It is fixed,
+//! rather than derived from the number of threads, so that the random streams
+//! assigned to each range do not depend on the degree of parallelism.
+constexpr size_t tsv_chunk_size = 16 << 20;
+
+//! The number of LT neighborhoods normalized with the same random stream.
+constexpr size_t lt_normalization_block = 4096;
+
+//! Split a random number generator into num streams and keep stream rank.
+template <typename PRNG>
+auto split_generator(PRNG &gen, size_t num, size_t rank, int)
+    -> decltype(gen.split(num, rank), void()) {
+  gen.split(num, rank);
+}
+
+//! Generators without streams (e.g., constant weights) are left untouched.
+template <typename PRNG>
+void split_generator(PRNG &, size_t, size_t, long) {}
+
+//! Skip blanks inside a line.
+inline void skip_blanks(const char *&p, const char *e) {
+  while (p < e && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+}
+
+//! Parse an unsigned integer from a line.
+//!
+//! \param p The position in the line, moved past the integer.
+//! \param e The end of the line.
+//! \param v The parsed value.
+//! \return false if no integer starts at p.
+template <typename T>
+bool parse_integer(const char *&p, const char *e, T &v) {
+  skip_blanks(p, e);
+  if (p == e || *p < '0' || *p > '9') return false;
+  T r = 0;
+  for (; p < e && *p >= '0' && *p <= '9'; ++p) r = r * 10 + (*p - '0');
+  v = r;
+  return true;
+}
+
+//! Convert a NUL-terminated token at the precision of the weights.
+inline void string_to_real(const char *token, char **end, float &v) {
+  v = std::strtof(token, end);
+}
+inline void string_to_real(const char *token, char **end, double &v) {
+  v = std::strtod(token, end);
+}
+
+//! Parse a floating point value from a line.
+//!
+//! \param p The position in the line, moved past the value.
+//! \param e The end of the line.
+//! \param v The parsed value.
+//! \return false if no value starts at p.
+template <typename T>
+bool parse_real(const char *&p, const char *e, T &v) {
+  skip_blanks(p, e);
+  // The input is not NUL-terminated: copy the token before converting it.
+  char token[64];
+  size_t length = 0;
+  while (p < e && length < sizeof(token) - 1 && *p != ' ' && *p != '\t' &&
+         *p != '\r')
+    token[length++] = *p++;
+  token[length] = '\0';
+  char *end;
+  string_to_real(token, &end, v);
+  return end != token;
+}
+
+//! Parse a text edge list in parallel.
+//!
+//! The file is mapped in memory and split in byte ranges of tsv_chunk_size,
+//! moved forward to the next line boundary.  Lines containing '%' or '#' are
+//! comments.  Each range is parsed by a line parser built for it, so that
+//! per-range state (e.g., a random stream) does not depend on the schedule.
+//!
+//! \tparam EdgeTy The type of edges.
+//! \tparam MakeParser The type of the factory of line parsers.
+//!
+//! \param inputFile The name of the input file.
+//! \param makeParser Called as makeParser(range, num_ranges), returns a
+//!    callable parsing the line [b, e) into an output vector of edges.
+//! \return the edges in file order.
+template <typename EdgeTy, typename MakeParser>
+std::vector<EdgeTy> parse_edge_list(const std::string &inputFile,
+                                    MakeParser makeParser) {
+  MappedFile file(inputFile);
+  const char *data = file.data();
+  size_t size = file.size();
+  file.advise(0, size, POSIX_MADV_SEQUENTIAL);
+
+  size_t num_chunks = (size + tsv_chunk_size - 1) / tsv_chunk_size;
+  std::vector<size_t> bounds(num_chunks + 1, size);
+  bounds[0] = 0;
+#pragma omp parallel for
+  for (size_t c = 1; c < num_chunks; ++c) {
+    const char *nl = static_cast<const char *>(
+        std::memchr(data + c * tsv_chunk_size - 1, '\n',
+                    size - c * tsv_chunk_size + 1));
+    bounds[c] = nl ? nl - data + 1 : size;
+  }
+
+  std::vector<std::vector<EdgeTy>> chunks(num_chunks);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t c = 0; c < num_chunks; ++c) {
+    auto parseLine = makeParser(c, num_chunks);
+    const char *p = data + bounds[c];
+    const char *end = data + bounds[c + 1];
+    while (p < end) {
+      const char *eol =
+          static_cast<const char *>(std::memchr(p, '\n', end - p));
+      if (eol == nullptr) eol = end;
+      if (std::memchr(p, '%', eol - p) == nullptr &&
+          std::memchr(p, '#', eol - p) == nullptr)
+        parseLine(p, eol, chunks[c]);
+      p = eol + 1;
+    }
+  }
+
+  std::vector<size_t> offsets(num_chunks + 1, 0);
+  for (size_t c = 0; c < num_chunks; ++c)
+    offsets[c + 1] = offsets[c] + chunks[c].size();
+
+  std::vector<EdgeTy> result(offsets.back());
+#pragma omp parallel for schedule(dynamic)
+  for (size_t c = 0; c < num_chunks; ++c) {
+    std::copy(chunks[c].begin(), chunks[c].end(), result.begin() + offsets[c]);
+    std::vector<EdgeTy>().swap(chunks[c]);
+  }
+  return result;
+}
+
+//! Normalize the weights of an edge list for the Linear Threshold model.
+//!
+//! The weights of the edges leaving a vertex, plus a random not-taking
+//! weight, are scaled to sum to one.  Neighborhoods are normalized in
+//! parallel, with a random stream per block of lt_normalization_block
+//! neighborhoods.
+//!
+//! \tparam EdgeTy The type of edges.
+//! \tparam PRNG The type of the parallel random number generator.
+//!
+//! \param edges The edge list, sorted by source on return.
+//! \param rand The random number generator.
+template <typename EdgeTy, typename PRNG>
+void normalize_linear_threshold(std::vector<EdgeTy> &edges, PRNG &rand) {
+  using weight_type = typename EdgeTy::weight_type;
+  parallel_sort(edges.begin(), edges.end(),
+                [](const EdgeTy &a, const EdgeTy &b) -> bool {
+                  return a.source < b.source;
+                });
+
+  std::vector<std::vector<size_t>> localStarts;
+#pragma omp parallel
+  {
+    size_t num_threads = omp_get_num_threads();
+    size_t rank = omp_get_thread_num();
+#pragma omp single
+    localStarts.resize(num_threads);
+
+    size_t low = edges.size() * rank / num_threads;
+    size_t high = edges.size() * (rank + 1) / num_threads;
+    for (size_t i = low; i < high; ++i)
+      if (i == 0 || edges[i].source != edges[i - 1].source)
+        localStarts[rank].push_back(i);
+  }
+
+  std::vector<size_t> starts;
+  for (auto &S : localStarts) starts.insert(starts.end(), S.begin(), S.end());
+  starts.push_back(edges.size());
+
+  size_t num_sources = starts.size() - 1;
+  size_t num_blocks =
+      (num_sources + lt_normalization_block - 1) / lt_normalization_block;
+#pragma omp parallel for schedule(dynamic)
+  for (size_t b = 0; b < num_blocks; ++b) {
+    auto gen = rand;
+    split_generator(gen, num_blocks, b, 0);
+
+    size_t last = std::min((b + 1) * lt_normalization_block, num_sources);
+    for (size_t s = b * lt_normalization_block; s < last; ++s) {
+      weight_type total = gen();
+      for (size_t i = starts[s]; i < starts[s + 1]; ++i)
+        total += edges[i].weight;
+      for (size_t i = starts[s]; i < starts[s + 1]; ++i)
+        edges[i].weight /= total;
+    }
+  }
+}
+
 //! Load an Edge List in TSV format and generate the weights.
 //!
 //! \tparam EdgeTy The type of edges.
@@ -81,58 +278,40 @@ template <typename EdgeTy, typename PRNG, typename diff_model_tag>
 std::vector<EdgeTy> load(const std::string &inputFile, const bool undirected,
                          PRNG &rand, const edge_list_tsv &&,
                          const diff_model_tag &&) {
-  std::ifstream GFS(inputFile);
-  size_t lineNumber = 0;
-
-  trng::uniform01_dist<float> probability;
-
-  std::vector<EdgeTy> result;
-  for (std::string line; std::getline(GFS, line); ++lineNumber) {
-    if (line.empty()) continue;
-    if (line.find('%') != std::string::npos) continue;
-    if (line.find('#') != std::string::npos) continue;
-
-    std::stringstream SS(line);
-
-    typename EdgeTy::vertex_type source;
-    typename EdgeTy::vertex_type destination;
-    typename EdgeTy::weight_type weight;
-    SS >> source >> destination;
-
-    weight = rand();
-    EdgeTy e = {source, destination, weight};
-    result.emplace_back(e);
-
-    if (undirected) {
-      weight = rand();
-      EdgeTy e = {destination, source, weight};
-      result.emplace_back(e);
-    }
-  }
-
-  if (std::is_same<diff_model_tag, ripples::linear_threshold_tag>::value) {
-    auto cmp = [](const EdgeTy &a, const EdgeTy &b) -> bool {
-      return a.source < b.source;
+  using vertex_type = typename EdgeTy::vertex_type;
+  using weight_type = typename EdgeTy::weight_type;
+
+  // Weights and LT normalization draw from disjoint streams.
+  PRNG weightGen(rand);
+  split_generator(weightGen, 2, 0, 0);
+  PRNG normalizationGen(rand);
+  split_generator(normalizationGen, 2, 1, 0);
+
+  auto makeParser = [&](size_t chunk, size_t num_chunks) {
+    PRNG gen(weightGen);
+    split_generator(gen, num_chunks, chunk, 0);
+    return [gen, undirected](const char *p, const char *e,
+                             std::vector<EdgeTy> &out) mutable {
+      vertex_type source;
+      vertex_type destination;
+      if (!parse_integer(p, e, source) || !parse_integer(p, e, destination))
+        return;
+
+      weight_type weight = gen();
+      out.push_back({source, destination, weight});
+
+      if (undirected) {
+        weight = gen();
+        out.push_back({destination, source, weight});
+      }
     };
+  };
 
-    std::sort(result.begin(), result.end(), cmp);
+  std::vector<EdgeTy> result =
+      parse_edge_list<EdgeTy>(inputFile, makeParser);
 
-    for (auto begin = result.begin(); begin != result.end();) {
-      auto end = std::upper_bound(begin, result.end(), *begin, cmp);
-      typename EdgeTy::weight_type not_taking = rand();
-      typename EdgeTy::weight_type total = std::accumulate(
-          begin, end, not_taking,
-          [](const typename EdgeTy::weight_type &a, const EdgeTy &b) ->
-          typename EdgeTy::weight_type { return a + b.weight; });
-
-      std::transform(begin, end, begin, [=](EdgeTy &e) -> EdgeTy {
-        e.weight /= total;
-        return e;
-      });
-
-      begin = end;
-    }
-  }
+  if (std::is_same<diff_model_tag, ripples::linear_threshold_tag>::value)
+    normalize_linear_threshold(result, normalizationGen);
 
   return result;
 }
@@ -145,36 +324,30 @@ std::vector<EdgeTy> load(const std::string &inputFile, const bool undirected,
 //!
 //! \param inputFile The name of the input file.
 //! \param undirected When true, the edge list is from an undirected graph.
-//! \param rand The random number generator.
 template <typename EdgeTy, typename PRNG, typename diff_model_tag>
 std::vector<EdgeTy> load(const std::string &inputFile, const bool undirected,
-                         PRNG &rand, const weighted_edge_list_tsv &&,
+                         PRNG &, const weighted_edge_list_tsv &&,
                          diff_model_tag &&) {
-  std::ifstream GFS(inputFile);
-  size_t lineNumber = 0;
-
-  std::vector<EdgeTy> result;
-  for (std::string line; std::getline(GFS, line); ++lineNumber) {
-    if (line.empty()) continue;
-    if (line.find('%') != std::string::npos) continue;
-    if (line.find('#') != std::string::npos) continue;
-
-    std::stringstream SS(line);
-
-    typename EdgeTy::vertex_type source;
-    typename EdgeTy::vertex_type destination;
-    typename EdgeTy::weight_type weight;
-    SS >> source >> destination >> weight;
-
-    EdgeTy e = {source, destination, weight};
-    result.emplace_back(e);
+  using vertex_type = typename EdgeTy::vertex_type;
+  using weight_type = typename EdgeTy::weight_type;
+
+  auto makeParser = [undirected](size_t, size_t) {
+    return [undirected](const char *p, const char *e,
+                        std::vector<EdgeTy> &out) {
+      vertex_type source;
+      vertex_type destination;
+      weight_type weight;
+      if (!parse_integer(p, e, source) || !parse_integer(p, e, destination) ||
+          !parse_real(p, e, weight))
+        return;
+
+      out.push_back({source, destination, weight});
+
+      if (undirected) out.push_back({destination, source, weight});
+    };
+  };
 
-    if (undirected) {
-      EdgeTy e = {destination, source, weight};
-      result.emplace_back(e);
-    }
-  }
-  return result;
+  return parse_edge_list<EdgeTy>(inputFile, makeParser);
 }
 
 }  // namespace
@@ -190,6 +363,9 @@ class WeightGenerator {
 
   float operator()() { return scale_factor_ * dist_(gen_); }
 
+  //! Split the underlying generator into num streams and keep stream rank.
+  void split(size_t num, size_t rank) { gen_.split(num, rank); }
+
  private:
   PRNG gen_;
   Distribution dist_;
@@ -232,6 +408,31 @@ std::vector<EdgeTy> loadEdgeList(const Configuration &CFG, PRNG &weightGen) {
 }
 
 namespace {
+//! Build the linear threshold index of backward graphs that support it.
+template <typename GraphTy>
+auto build_lt_index(GraphTy &G, int)
+    -> decltype(G.build_lt_index(), void()) {
+  using backward = BackwardDirection<typename GraphTy::vertex_type>;
+  if (std::is_same<typename GraphTy::direction_type, backward>::value &&
+      !G.has_lt_index())
+    G.build_lt_index();
+}
+
+template <typename GraphTy>
+void build_lt_index(GraphTy &, long) {}
+
+//! Build the equal-weight run index of backward graphs that support it.
+template <typename GraphTy>
+auto build_ic_runs(GraphTy &G, int) -> decltype(G.build_ic_runs(), void()) {
+  using backward = BackwardDirection<typename GraphTy::vertex_type>;
+  if (std::is_same<typename GraphTy::direction_type, backward>::value &&
+      !G.has_ic_runs())
+    G.build_ic_runs();
+}
+
+template <typename GraphTy>
+void build_ic_runs(GraphTy &, long) {}
+
 template <typename GraphTy, typename ConfTy, typename PrngTy>
 GraphTy loadGraph_helper(ConfTy &CFG, PrngTy &PRNG) {
   GraphTy G;
@@ -244,11 +445,13 @@ GraphTy loadGraph_helper(ConfTy &CFG, PrngTy &PRNG) {
     GraphTy tmpG(edgeList.begin(), edgeList.end(), !CFG.disable_renumbering);
     G = std::move(tmpG);
   } else {
-    std::ifstream binaryDump(CFG.IFileName, std::ios::binary);
-    GraphTy tmpG(binaryDump);
-    G = std::move(tmpG);
+    G = GraphTy::map_binary(CFG.IFileName);
   }
 
+  if (CFG.reordering != "none") G = reorder(G, CFG.reordering);
+  if (CFG.diffusionModel == "IC") build_ic_runs(G, 0);
+  if (CFG.diffusionModel == "LT") build_lt_index(G, 0);
+
   return G;
 }
 }  // namespace
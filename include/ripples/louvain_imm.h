@@ -229,16 +229,21 @@ auto LouvainIMM(const std::vector<GraphTy> &communities, ConfTy &CFG, double l,
   size_t k = CFG.k;
   double epsilon = CFG.epsilon;
 
-  using RRRsetCollection = std::vector<RRRset<GraphTy>>;
+  // The sets live in the arenas of the stores, the seed selection only
+  // reorders their views.
+  std::vector<RRRsetStore<GraphTy>> stores;
+  stores.reserve(communities.size());
+  using RRRsetCollection = std::vector<RRRsetView<vertex_type>>;
   std::vector<RRRsetCollection> R(communities.size());
 
   // For each community do ThetaEstimation and Sampling
   for (size_t i = 0; i < communities.size(); ++i) {
     double l_1 = l * (1 + 1 / std::log2(communities[i].num_nodes()));
 
-    R[i] = Sampling(communities[i], CFG, l_1, gen, records[i],
-                    std::forward<diff_model_tag>(model_tag),
-                    std::forward<sequential_tag>(ex_tag));
+    stores.push_back(Sampling(communities[i], CFG, l_1, gen, records[i],
+                              std::forward<diff_model_tag>(model_tag),
+                              std::forward<sequential_tag>(ex_tag)));
+    R[i] = stores.back().sets();
   }
 
   // Global seed selection using the heap
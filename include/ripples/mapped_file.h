@@ -0,0 +1,149 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_MAPPED_FILE_H
+#define RIPPLES_MAPPED_FILE_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ripples {
+
+//! \brief A read-only memory mapping of a whole file.
+//!
+//! The mapping is shared, so processes mapping the same file on a node share
+//! the same page-cache copy.  The object owns the mapping and releases it on
+//! destruction.
+class MappedFile {
+ public:
+  //! Empty mapping.
+  MappedFile() : data_(nullptr), size_(0) {}
+
+  //! Map a file in memory.
+  //!
+  //! \param FileName The path of the file to be mapped.
+  explicit MappedFile(const std::string &FileName) : MappedFile() {
+    int fd = open(FileName.c_str(), O_RDONLY);
+    if (fd == -1) throw std::runtime_error("Unable to open " + FileName);
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+      close(fd);
+      throw std::runtime_error("Unable to stat " + FileName);
+    }
+    size_ = sb.st_size;
+
+    if (size_ != 0) {
+      void *addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Unable to mmap " + FileName);
+      }
+      data_ = static_cast<char *>(addr);
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  //! Move constructor.
+  //! \param O The mapping to be moved.
+  MappedFile(MappedFile &&O) : data_(O.data_), size_(O.size_) {
+    O.data_ = nullptr;
+    O.size_ = 0;
+  }
+
+  //! Move assignment operator.
+  //! \param O The mapping to be moved.
+  //! \return a reference to the destination mapping.
+  MappedFile &operator=(MappedFile &&O) {
+    if (this == &O) return *this;
+    release();
+    data_ = O.data_;
+    size_ = O.size_;
+    O.data_ = nullptr;
+    O.size_ = 0;
+    return *this;
+  }
+
+  ~MappedFile() { release(); }
+
+  //! Hint the kernel about the expected access pattern of a region.
+  //!
+  //! \param offset The start of the region, relative to the begin of the file.
+  //! \param length The length of the region.
+  //! \param advice One of the POSIX_MADV_* constants.
+  void advise(size_t offset, size_t length, int advice) const {
+    if (data_ == nullptr) return;
+    long page = sysconf(_SC_PAGE_SIZE);
+    size_t begin = offset - offset % page;
+    posix_madvise(data_ + begin, length + (offset - begin), advice);
+  }
+
+  //! The begin of the mapped region.
+  const char *data() const { return data_; }
+  //! The size in bytes of the mapped region.
+  size_t size() const { return size_; }
+  //! True when a file is mapped.
+  bool is_mapped() const { return data_ != nullptr; }
+
+ private:
+  void release() {
+    if (data_ != nullptr) munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  char *data_;
+  size_t size_;
+};
+
+}  // namespace ripples
+
+#endif  // RIPPLES_MAPPED_FILE_H
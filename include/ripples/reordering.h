@@ -0,0 +1,233 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_REORDERING_H
+#define RIPPLES_REORDERING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ripples/utility.h"
+
+namespace ripples {
+
+namespace {
+
+//! Turn a vertex order into the permutation expected by Graph::permute.
+template <typename VertexTy>
+std::vector<VertexTy> order_to_permutation(const std::vector<VertexTy> &order) {
+  std::vector<VertexTy> permutation(order.size());
+#pragma omp parallel for
+  for (size_t i = 0; i < order.size(); ++i) permutation[order[i]] = i;
+  return permutation;
+}
+
+//! Vertices sorted by decreasing degree, ties broken by ID.
+template <typename GraphTy>
+std::vector<typename GraphTy::vertex_type> vertices_by_degree(
+    const GraphTy &G) {
+  using vertex_type = typename GraphTy::vertex_type;
+  std::vector<vertex_type> order(G.num_nodes());
+  std::iota(order.begin(), order.end(), 0);
+  parallel_sort(order.begin(), order.end(),
+                [&](const vertex_type &a, const vertex_type &b) {
+                  return G.degree(a) > G.degree(b);
+                });
+  return order;
+}
+
+}  // namespace
+
+//! \brief Degree ordering.
+//!
+//! High-degree vertices, which are the most likely to appear in RRR sets, get
+//! the smallest IDs so that their counters and neighbor lists share cache
+//! lines.
+//!
+//! \tparam GraphTy The type of the graph.
+//!
+//! \param G The graph.
+//! \return the new ID of each vertex.
+template <typename GraphTy>
+std::vector<typename GraphTy::vertex_type> degree_ordering(const GraphTy &G) {
+  return order_to_permutation(vertices_by_degree(G));
+}
+
+//! \brief Reverse Cuthill-McKee ordering.
+//!
+//! Every component is visited in BFS order starting from its vertex of
+//! smallest degree, with the neighbors of each vertex enqueued by increasing
+//! degree.  The order is then reversed.  Vertices visited together by a BFS
+//! end up with close IDs.
+//!
+//! \tparam GraphTy The type of the graph.
+//!
+//! \param G The graph.
+//! \return the new ID of each vertex.
+template <typename GraphTy>
+std::vector<typename GraphTy::vertex_type> rcm_ordering(const GraphTy &G) {
+  using vertex_type = typename GraphTy::vertex_type;
+  std::vector<vertex_type> roots = vertices_by_degree(G);
+  std::reverse(roots.begin(), roots.end());
+
+  std::vector<vertex_type> order;
+  order.reserve(G.num_nodes());
+  std::vector<bool> visited(G.num_nodes(), false);
+  std::vector<vertex_type> neighbors;
+
+  for (vertex_type root : roots) {
+    if (visited[root]) continue;
+    visited[root] = true;
+    size_t head = order.size();
+    order.push_back(root);
+
+    for (; head < order.size(); ++head) {
+      neighbors.clear();
+      for (auto u : G.neighbors(order[head])) {
+        if (visited[u.vertex]) continue;
+        visited[u.vertex] = true;
+        neighbors.push_back(u.vertex);
+      }
+      std::sort(neighbors.begin(), neighbors.end(),
+                [&](const vertex_type &a, const vertex_type &b) {
+                  return G.degree(a) < G.degree(b) ||
+                         (G.degree(a) == G.degree(b) && a < b);
+                });
+      order.insert(order.end(), neighbors.begin(), neighbors.end());
+    }
+  }
+
+  std::reverse(order.begin(), order.end());
+  return order_to_permutation(order);
+}
+
+//! \brief Gorder-like greedy ordering.
+//!
+//! Vertices are placed one at a time.  The next vertex is the one maximizing
+//! its score against the last \p window placed vertices, where a vertex scores
+//! a point for every edge and every path of length two connecting it to a
+//! vertex in the window.  Paths of length two are only followed through
+//! vertices of degree up to \p max_degree, which bounds the cost on hubs.
+//! When no vertex has a positive score, the unplaced vertex of largest degree
+//! is picked.
+//!
+//! \tparam GraphTy The type of the graph.
+//!
+//! \param G The graph.
+//! \param window The number of recently placed vertices scored against.
+//! \param max_degree The largest degree followed by paths of length two.
+//! \return the new ID of each vertex.
+template <typename GraphTy>
+std::vector<typename GraphTy::vertex_type> gorder_ordering(
+    const GraphTy &G, size_t window = 5, size_t max_degree = 256) {
+  using vertex_type = typename GraphTy::vertex_type;
+  std::vector<vertex_type> byDegree = vertices_by_degree(G);
+
+  std::vector<size_t> score(G.num_nodes(), 0);
+  std::vector<bool> placed(G.num_nodes(), false);
+  std::priority_queue<std::pair<size_t, vertex_type>> candidates;
+
+  auto update = [&](vertex_type v, bool increment) {
+    auto bump = [&](vertex_type u) {
+      if (placed[u]) return;
+      score[u] = increment ? score[u] + 1 : score[u] - 1;
+      if (score[u] != 0) candidates.emplace(score[u], u);
+    };
+    for (auto u : G.neighbors(v)) {
+      bump(u.vertex);
+      if (G.degree(u.vertex) > max_degree) continue;
+      for (auto x : G.neighbors(u.vertex))
+        if (x.vertex != v) bump(x.vertex);
+    }
+  };
+
+  std::vector<vertex_type> order;
+  order.reserve(G.num_nodes());
+  auto next = byDegree.begin();
+  while (order.size() < G.num_nodes()) {
+    vertex_type v;
+    while (!candidates.empty() &&
+           (placed[candidates.top().second] ||
+            score[candidates.top().second] != candidates.top().first))
+      candidates.pop();
+    if (!candidates.empty()) {
+      v = candidates.top().second;
+      candidates.pop();
+    } else {
+      while (placed[*next]) ++next;
+      v = *next;
+    }
+
+    placed[v] = true;
+    order.push_back(v);
+    update(v, true);
+    if (order.size() > window) update(order[order.size() - window - 1], false);
+  }
+
+  return order_to_permutation(order);
+}
+
+//! \brief Relabel the vertices of a graph to improve locality.
+//!
+//! \tparam GraphTy The type of the graph.
+//!
+//! \param G The graph.
+//! \param strategy One of none, degree, rcm or gorder.
+//! \return the relabeled graph.
+template <typename GraphTy>
+GraphTy reorder(const GraphTy &G, const std::string &strategy) {
+  if (strategy == "none") return G;
+  if (strategy == "degree") return G.permute(degree_ordering(G));
+  if (strategy == "rcm") return G.permute(rcm_ordering(G));
+  if (strategy == "gorder") return G.permute(gorder_ordering(G));
+  throw std::domain_error("Unsupported reordering");
+}
+
+}  // namespace ripples
+
+#endif  // RIPPLES_REORDERING_H
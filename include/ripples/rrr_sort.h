@@ -0,0 +1,126 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_RRR_SORT_H
+#define RIPPLES_RRR_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace ripples {
+
+//! Sets up to this size are sorted by insertion.
+constexpr size_t rrr_sort_insertion_max = 32;
+//! Sets whose vertices span at most this many IDs per vertex are emitted by
+//! scanning the visited set over their span.
+constexpr size_t rrr_sort_scan_density = 8;
+
+//! \brief Sort the vertices of an RRR set without comparison sorting.
+//!
+//! The algorithm depends on the size and the span of the set:
+//!  - small sets are sorted by insertion;
+//!  - sets that are dense in their ID span are rebuilt by scanning the span
+//!    for the members of the set, which the traversal already knows;
+//!  - the others are radix sorted on the offsets from their smallest vertex,
+//!    one pass per significant byte of the span.
+//!
+//! \tparam Itr A random access iterator over vertices.
+//! \tparam IsMember A predicate telling whether a vertex is in the set.
+//!
+//! \param first The begin of the vertices of the set.
+//! \param last The end of the vertices of the set.
+//! \param buffer The scratch of the radix sort, reused across calls.
+//! \param is_member The membership predicate of the traversal.
+template <typename Itr, typename IsMember>
+void SortRRRSet(Itr first, Itr last,
+                std::vector<typename std::iterator_traits<Itr>::value_type> &buffer,
+                IsMember &&is_member) {
+  using vertex_type = typename std::iterator_traits<Itr>::value_type;
+  size_t size = std::distance(first, last);
+  if (size < 2) return;
+
+  if (size <= rrr_sort_insertion_max) {
+    for (Itr i = std::next(first); i != last; ++i) {
+      vertex_type v = *i;
+      Itr j = i;
+      for (; j != first && *std::prev(j) > v; --j) *j = *std::prev(j);
+      *j = v;
+    }
+    return;
+  }
+
+  auto bounds = std::minmax_element(first, last);
+  vertex_type lo = *bounds.first;
+  uint64_t span = uint64_t(*bounds.second) - lo + 1;
+
+  if (span <= rrr_sort_scan_density * size) {
+    // Branch-free: out only passes the last member once the scan reaches it.
+    Itr out = first;
+    for (uint64_t v = lo; v != lo + span; ++v) {
+      *out = vertex_type(v);
+      out += is_member(vertex_type(v));
+    }
+    return;
+  }
+
+  buffer.resize(size);
+  vertex_type *src = &*first;
+  vertex_type *dst = buffer.data();
+  size_t passes = 0;
+  for (size_t shift = 0; shift < 64 && ((span - 1) >> shift) != 0;
+       shift += 8, ++passes) {
+    size_t count[257] = {0};
+    for (size_t i = 0; i < size; ++i) ++count[((src[i] - lo) >> shift & 0xff) + 1];
+    for (size_t d = 1; d < 257; ++d) count[d] += count[d - 1];
+    for (size_t i = 0; i < size; ++i)
+      dst[count[(src[i] - lo) >> shift & 0xff]++] = src[i];
+    std::swap(src, dst);
+  }
+  if (passes % 2 == 1) std::copy(buffer.begin(), buffer.end(), first);
+}
+
+}  // namespace ripples
+
+#endif /* RIPPLES_RRR_SORT_H */
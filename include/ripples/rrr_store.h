@@ -0,0 +1,402 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_RRR_STORE_H
+#define RIPPLES_RRR_STORE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ripples {
+
+//! \brief A Random Reverse Reachability set stored in an arena.
+//!
+//! The view does not own the vertices: they live in the RRRStore that produced
+//! it.  Views are plain values, so sequences of views can be partitioned and
+//! swapped by the seed selection without touching the vertices.  Like a span,
+//! a view gives write access to the vertices, which the Huffman encoder uses
+//! to move the most frequent vertex to the front of a set.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+template <typename VertexTy>
+class RRRsetView {
+ public:
+  using value_type = VertexTy;
+  using iterator = VertexTy *;
+  using const_iterator = const VertexTy *;
+
+  RRRsetView() : data_(nullptr), size_(0) {}
+  RRRsetView(VertexTy *data, size_t size) : data_(data), size_(size) {}
+
+  VertexTy *begin() const { return data_; }
+  VertexTy *end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  VertexTy &operator[](size_t i) const { return data_[i]; }
+
+  //! Forget the vertices.  Their storage is released with the arena.
+  void clear() { size_ = 0; }
+  //! Nothing to do: the storage belongs to the arena.
+  void shrink_to_fit() {}
+
+  bool operator==(const RRRsetView &O) const {
+    return std::equal(begin(), end(), O.begin(), O.end());
+  }
+
+ private:
+  VertexTy *data_;
+  size_t size_;
+};
+
+template <typename VertexTy, typename AllocatorTy>
+class RRRStore;
+
+//! \brief A writable handle to an entry of an RRRStore.
+//!
+//! This is what the iterators of an RRRStore point to: the generators store
+//! a sampled RRR set through it and the streaming workers inspect the result.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+//! \tparam AllocatorTy The allocator of the arena.
+template <typename VertexTy, typename AllocatorTy>
+class RRRStoreSlot {
+ public:
+  RRRStoreSlot(RRRStore<VertexTy, AllocatorTy> *store, size_t index)
+      : store_(store), index_(index) {}
+
+  //! Copy an RRR set into the arena of the calling thread.
+  template <typename Itr>
+  void assign(Itr B, Itr E) {
+    store_->assign(index_, B, E);
+  }
+
+  const VertexTy *begin() const { return view().begin(); }
+  const VertexTy *end() const { return view().end(); }
+  size_t size() const { return view().size(); }
+  bool empty() const { return view().empty(); }
+  const VertexTy &operator[](size_t i) const { return view()[i]; }
+  void clear() { store_->sets()[index_].clear(); }
+  void shrink_to_fit() {}
+
+ private:
+  const RRRsetView<VertexTy> &view() const { return store_->sets()[index_]; }
+
+  RRRStore<VertexTy, AllocatorTy> *store_;
+  size_t index_;
+};
+
+//! \brief Append-only storage of Random Reverse Reachability sets.
+//!
+//! The vertices of all the sets are packed in large chunks, one arena per
+//! OpenMP thread, and the store keeps an index of (begin, size) views into
+//! them.  Storing a set is a bump-pointer copy into the arena of the calling
+//! thread, so generating theta sets costs a handful of chunk allocations
+//! instead of one heap allocation per set, and growing theta only grows the
+//! index.  Chunks are never moved, so views stay valid until release().
+//!
+//! Sets can be stored concurrently from different threads as long as each
+//! thread writes different entries.  The arena of a thread is created, under
+//! a lock, the first time the thread stores a set, so the store works with
+//! any number of workers and with nested or dynamic OpenMP teams.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+//! \tparam AllocatorTy The allocator used for the chunks of the arenas.
+template <typename VertexTy, typename AllocatorTy = std::allocator<VertexTy>>
+class RRRStore {
+ public:
+  //! The type of the stored sets.
+  using value_type = RRRsetView<VertexTy>;
+  //! The handle used to write the stored sets.
+  using slot_type = RRRStoreSlot<VertexTy, AllocatorTy>;
+
+  //! The number of vertices of a chunk of an arena.
+  static constexpr size_t chunk_size = size_t(1) << 20;
+
+  //! \brief Random access iterator over the slots of the store.
+  class iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = slot_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = slot_type;
+
+    iterator() : store_(nullptr), index_(0) {}
+    iterator(RRRStore *store, size_t index) : store_(store), index_(index) {}
+
+    slot_type operator*() const { return slot_type(store_, index_); }
+    slot_type operator[](difference_type n) const { return *(*this + n); }
+
+    iterator &operator++() {
+      ++index_;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator tmp(*this);
+      ++index_;
+      return tmp;
+    }
+    iterator &operator--() {
+      --index_;
+      return *this;
+    }
+    iterator operator--(int) {
+      iterator tmp(*this);
+      --index_;
+      return tmp;
+    }
+    iterator &operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+    iterator &operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+    iterator operator+(difference_type n) const {
+      return iterator(store_, index_ + n);
+    }
+    friend iterator operator+(difference_type n, const iterator &I) {
+      return I + n;
+    }
+    iterator operator-(difference_type n) const {
+      return iterator(store_, index_ - n);
+    }
+    difference_type operator-(const iterator &O) const {
+      return difference_type(index_) - difference_type(O.index_);
+    }
+
+    bool operator==(const iterator &O) const { return index_ == O.index_; }
+    bool operator!=(const iterator &O) const { return index_ != O.index_; }
+    bool operator<(const iterator &O) const { return index_ < O.index_; }
+    bool operator>(const iterator &O) const { return index_ > O.index_; }
+    bool operator<=(const iterator &O) const { return index_ <= O.index_; }
+    bool operator>=(const iterator &O) const { return index_ >= O.index_; }
+
+   private:
+    RRRStore *store_;
+    size_t index_;
+  };
+
+  //! Empty store.
+  //! \param allocator The allocator used for the chunks of the arenas.
+  explicit RRRStore(const AllocatorTy &allocator = AllocatorTy())
+      : allocator_(allocator), id_(next_id()) {}
+
+  RRRStore(const RRRStore &) = delete;
+  RRRStore &operator=(const RRRStore &) = delete;
+
+  // The arenas do not move in memory, so the threads that cached them keep
+  // using them through the new store, while the moved-from store gets a new
+  // identity.
+  RRRStore(RRRStore &&O)
+      : allocator_(std::move(O.allocator_)),
+        sets_(std::move(O.sets_)),
+        arenas_(std::move(O.arenas_)),
+        owners_(std::move(O.owners_)),
+        id_(O.id_) {
+    O.arenas_.clear();
+    O.owners_.clear();
+    O.id_ = next_id();
+  }
+  RRRStore &operator=(RRRStore &&O) {
+    if (this == &O) return *this;
+    release();
+    allocator_ = std::move(O.allocator_);
+    sets_ = std::move(O.sets_);
+    arenas_ = std::move(O.arenas_);
+    owners_ = std::move(O.owners_);
+    id_ = O.id_;
+    O.arenas_.clear();
+    O.owners_.clear();
+    O.id_ = next_id();
+    return *this;
+  }
+
+  ~RRRStore() { release(); }
+
+  //! The number of sets in the store.
+  size_t size() const { return sets_.size(); }
+  bool empty() const { return sets_.empty(); }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, sets_.size()); }
+
+  //! \brief The index of the store.
+  //!
+  //! The seed selection and the encoders work on this sequence of views and
+  //! are free to reorder it.
+  std::vector<value_type> &sets() { return sets_; }
+  const std::vector<value_type> &sets() const { return sets_; }
+
+  const value_type &operator[](size_t i) const { return sets_[i]; }
+
+  //! Append empty entries at the end of the store.
+  //! \param count The number of entries to append.
+  void extend(size_t count) { sets_.resize(sets_.size() + count); }
+
+  //! \brief Store an RRR set.
+  //!
+  //! The vertices are copied into the arena of the calling thread.
+  //!
+  //! \param i The entry where to store the set.
+  //! \param B The begin of the vertices of the set.
+  //! \param E The end of the vertices of the set.
+  template <typename Itr>
+  void assign(size_t i, Itr B, Itr E) {
+    size_t size = std::distance(B, E);
+    VertexTy *data = thread_arena().allocate(allocator_, size);
+    std::copy(B, E, data);
+    sets_[i] = value_type(data, size);
+  }
+
+  //! \brief Release the arenas.
+  //!
+  //! All the entries become empty.  This is meant for when the sets have been
+  //! moved to another representation, as the HBMax encoders do.
+  void release() {
+    for (auto &s : sets_) s.clear();
+    for (auto &a : arenas_) a.release(allocator_);
+  }
+
+  //! \brief Reuse the arena of the calling thread from its start.
+  //!
+  //! The sets stored by the thread are left dangling, so this is only for
+  //! when they have already been encoded and cleared, as the fused HBMax
+  //! encoders do after each chunk.
+  void rewind() { thread_arena().rewind(allocator_); }
+
+  //! The number of bytes used by the arenas and the index.
+  size_t memory_footprint() const {
+    size_t bytes = sets_.capacity() * sizeof(value_type);
+    for (auto &a : arenas_) bytes += a.capacity * sizeof(VertexTy);
+    return bytes;
+  }
+
+ private:
+  struct Chunk {
+    VertexTy *data;
+    size_t size;
+  };
+
+  struct Arena {
+    std::vector<Chunk> chunks;
+    size_t used = 0;
+    size_t capacity = 0;
+
+    VertexTy *allocate(AllocatorTy &allocator, size_t n) {
+      if (chunks.empty() || chunks.back().size - used < n) {
+        size_t size = std::max(chunk_size, n);
+        chunks.push_back(Chunk{allocator.allocate(size), size});
+        capacity += size;
+        used = 0;
+      }
+      VertexTy *result = chunks.back().data + used;
+      used += n;
+      return result;
+    }
+
+    void rewind(AllocatorTy &allocator) {
+      if (chunks.empty()) return;
+      for (size_t i = 1; i < chunks.size(); ++i)
+        allocator.deallocate(chunks[i].data, chunks[i].size);
+      chunks.resize(1);
+      used = 0;
+      capacity = chunks.front().size;
+    }
+
+    void release(AllocatorTy &allocator) {
+      for (auto &c : chunks) allocator.deallocate(c.data, c.size);
+      chunks.clear();
+      used = 0;
+      capacity = 0;
+    }
+  };
+
+  // The arena of the calling thread.  Each thread caches the arena it used
+  // last together with the identity of its store, so the lock is taken only
+  // when a thread switches store.
+  Arena &thread_arena() {
+    thread_local std::pair<uint64_t, Arena *> cache(0, nullptr);
+    if (cache.first == id_) return *cache.second;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto owner = std::find(owners_.begin(), owners_.end(),
+                           std::this_thread::get_id());
+    if (owner == owners_.end()) {
+      owners_.push_back(std::this_thread::get_id());
+      arenas_.emplace_back();
+      owner = owners_.end() - 1;
+    }
+    cache = std::make_pair(id_, &arenas_[owner - owners_.begin()]);
+    return *cache.second;
+  }
+
+  static uint64_t next_id() {
+    static std::atomic<uint64_t> counter(0);
+    return ++counter;
+  }
+
+  AllocatorTy allocator_;
+  std::vector<value_type> sets_;
+  std::deque<Arena> arenas_;  // Never moves its elements when it grows.
+  std::vector<std::thread::id> owners_;
+  std::mutex mutex_;
+  uint64_t id_;
+};
+
+template <typename VertexTy, typename AllocatorTy>
+constexpr size_t RRRStore<VertexTy, AllocatorTy>::chunk_size;
+
+}  // namespace ripples
+
+#endif /* RIPPLES_RRR_STORE_H */
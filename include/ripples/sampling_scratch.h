@@ -0,0 +1,276 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_SAMPLING_SCRATCH_H
+#define RIPPLES_SAMPLING_SCRATCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ripples {
+
+//! \brief A set of visited vertices that is cleared in constant time.
+//!
+//! Every vertex stores the epoch in which it was last visited: starting a new
+//! traversal increments the current epoch instead of zeroing the array, so
+//! that the cost of a traversal depends on the vertices it visits and not on
+//! the size of the graph.  The array is zeroed only when the epoch counter
+//! wraps around or the array grows.  It is never shrunk, so that alternating
+//! between graphs of different sizes does not reallocate it.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+template <typename VertexTy>
+class EpochVisitedSet {
+ public:
+  EpochVisitedSet() : epoch_(0) {}
+
+  //! Start a new traversal on a graph with the given number of vertices.
+  //! \param num_nodes The number of vertices of the graph.
+  void reset(size_t num_nodes) {
+    if (stamps_.size() < num_nodes) {
+      stamps_.assign(num_nodes, 0);
+      epoch_ = 0;
+    }
+    if (++epoch_ == 0) {
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      epoch_ = 1;
+    }
+  }
+
+  //! Has the vertex been visited in the current traversal?
+  bool operator[](VertexTy v) const { return stamps_[v] == epoch_; }
+
+  //! Mark a vertex as visited in the current traversal.
+  void insert(VertexTy v) { stamps_[v] = epoch_; }
+
+ private:
+  std::vector<uint32_t> stamps_;
+  uint32_t epoch_;
+};
+
+//! \brief A set of visited vertices shared by the threads of a traversal.
+//!
+//! One bit per vertex, set with an atomic fetch_or, so that exactly one
+//! of the threads that reach a vertex at the same time inserts it.
+class AtomicVisitedSet {
+ public:
+  AtomicVisitedSet() : num_words_(0) {}
+
+  //! Prepare the set for a new traversal.
+  //! \param num_nodes The number of vertices of the graph.
+  void reset(size_t num_nodes) {
+    size_t num_words = (num_nodes + 63) / 64;
+    if (num_words > num_words_) {
+      words_.reset(new std::atomic<uint64_t>[num_words]);
+      num_words_ = num_words;
+    }
+    for (size_t i = 0; i < num_words; ++i)
+      words_[i].store(0, std::memory_order_relaxed);
+  }
+
+  bool operator[](size_t v) const {
+    return words_[v / 64].load(std::memory_order_relaxed) &
+           (uint64_t(1) << (v % 64));
+  }
+
+  //! Insert a vertex.
+  //! \return true if the calling thread inserted it.
+  bool insert(size_t v) {
+    uint64_t bit = uint64_t(1) << (v % 64);
+    return !(words_[v / 64].fetch_or(bit, std::memory_order_relaxed) & bit);
+  }
+
+ private:
+  std::unique_ptr<std::atomic<uint64_t>[]> words_;
+  size_t num_words_;
+};
+
+//! \brief A double-ended queue of vertices on a circular buffer.
+//!
+//! The buffer grows to the largest frontier seen and is never shrunk, so that
+//! a traversal reusing the queue does not allocate.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+template <typename VertexTy>
+class RingQueue {
+ public:
+  RingQueue() : buffer_(16), head_(0), size_(0) {}
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  //! Remove all the elements without releasing the buffer.
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  VertexTy front() const { return buffer_[head_]; }
+
+  void pop_front() {
+    head_ = (head_ + 1) & mask();
+    --size_;
+  }
+
+  void push_back(VertexTy v) {
+    if (size_ == buffer_.size()) grow();
+    buffer_[(head_ + size_) & mask()] = v;
+    ++size_;
+  }
+
+  void push_front(VertexTy v) {
+    if (size_ == buffer_.size()) grow();
+    head_ = (head_ + buffer_.size() - 1) & mask();
+    buffer_[head_] = v;
+    ++size_;
+  }
+
+ private:
+  size_t mask() const { return buffer_.size() - 1; }
+
+  // Double the capacity, keeping it a power of two, and unroll the content
+  // at the beginning of the new buffer.
+  void grow() {
+    std::vector<VertexTy> buffer(2 * buffer_.size());
+    for (size_t i = 0; i < size_; ++i)
+      buffer[i] = buffer_[(head_ + i) & mask()];
+    buffer_.swap(buffer);
+    head_ = 0;
+  }
+
+  std::vector<VertexTy> buffer_;
+  size_t head_;
+  size_t size_;
+};
+
+//! \brief The state of a reverse traversal, reused across samples.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+template <typename VertexTy>
+struct SamplingScratch {
+  EpochVisitedSet<VertexTy> visited;  //!< The vertices already reached.
+  RingQueue<VertexTy> queue;          //!< The frontier of the traversal.
+  std::vector<VertexTy> sort_buffer;  //!< The scratch of SortRRRSet.
+
+  //! Prepare the scratch for a new traversal.
+  //! \param num_nodes The number of vertices of the graph.
+  void reset(size_t num_nodes) {
+    visited.reset(num_nodes);
+    queue.clear();
+  }
+};
+
+//! \brief The sampling scratch of the calling thread.
+//!
+//! Each thread owns one scratch per vertex type, allocated on first use and
+//! kept for the lifetime of the thread.  The scratch is reset for a new
+//! traversal on a graph of the given size.  It grows to the largest graph
+//! the thread has sampled and is never shrunk: it retains 4 bytes per vertex
+//! of that graph, plus the largest frontier, until the thread exits.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+//! \param num_nodes The number of vertices of the graph.
+//! \return the reset scratch of the calling thread.
+template <typename VertexTy>
+SamplingScratch<VertexTy> &thread_sampling_scratch(size_t num_nodes) {
+  thread_local SamplingScratch<VertexTy> scratch;
+  scratch.reset(num_nodes);
+  return scratch;
+}
+
+//! The number of samples traversed together by the bit-parallel kernels.
+constexpr size_t bit_parallel_batch_size = 64;
+
+//! \brief The state of a bit-parallel traversal of up to 64 samples.
+//!
+//! Bit i of a mask stands for the i-th sample of the batch.  Only the
+//! vertices reached in the previous batch are cleared on reset.  Like
+//! EpochVisitedSet, the masks grow to the largest graph and never shrink.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+template <typename VertexTy>
+struct BitParallelScratch {
+  std::vector<uint64_t> reached;  //!< The samples that reached each vertex.
+  std::vector<uint64_t> pending;  //!< The samples still to expand per vertex.
+  std::vector<VertexTy> touched;  //!< The vertices with a non-empty mask.
+  RingQueue<VertexTy> queue;      //!< The vertices with pending samples.
+  std::vector<std::vector<VertexTy>> sets;  //!< The extracted RRR sets.
+  std::vector<VertexTy> sort_buffer;        //!< The scratch of SortRRRSet.
+
+  //! Prepare the scratch for a new batch.
+  //! \param num_nodes The number of vertices of the graph.
+  void reset(size_t num_nodes) {
+    if (reached.size() < num_nodes) {
+      reached.assign(num_nodes, 0);
+      pending.assign(num_nodes, 0);
+    } else {
+      for (auto v : touched) reached[v] = 0;
+    }
+    touched.clear();
+    queue.clear();
+    sets.resize(bit_parallel_batch_size);
+    for (auto &S : sets) S.clear();
+  }
+};
+
+//! \brief The bit-parallel sampling scratch of the calling thread.
+//!
+//! The scratch is kept until the thread exits and retains 16 bytes per vertex
+//! of the largest graph the thread has sampled.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+//! \param num_nodes The number of vertices of the graph.
+//! \return the reset scratch of the calling thread.
+template <typename VertexTy>
+BitParallelScratch<VertexTy> &thread_bit_parallel_scratch(size_t num_nodes) {
+  thread_local BitParallelScratch<VertexTy> scratch;
+  scratch.reset(num_nodes);
+  return scratch;
+}
+
+}  // namespace ripples
+
+#endif /* RIPPLES_SAMPLING_SCRATCH_H */
@@ -0,0 +1,264 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_SMALL_RRR_SET_H
+#define RIPPLES_SMALL_RRR_SET_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace ripples {
+
+//! \brief Default inline capacity of a SmallRRRset.
+//!
+//! The capacity that makes the whole set, header included, one cache line:
+//! 10 vertices for 32-bit vertex identifiers.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+template <typename VertexTy>
+constexpr size_t small_rrr_set_capacity() {
+  return (64 - sizeof(VertexTy *) - 2 * sizeof(size_t)) / sizeof(VertexTy);
+}
+
+//! \brief A Random Reverse Reachability set with inline storage.
+//!
+//! LT reverse walks are short simple paths and IC samples on sparse
+//! probabilities are mostly one or two vertices.  The set keeps up to
+//! InlineCapacity vertices inside the object and moves to the heap, through
+//! the allocator, only when it grows past that.  The interface is the subset
+//! of std::vector used on RRR sets, with pointers as iterators.
+//!
+//! \tparam VertexTy The integer type representing vertices.
+//! \tparam AllocatorTy The allocator used once the set spills to the heap.
+//! \tparam InlineCapacity The number of vertices stored inline.
+template <typename VertexTy, typename AllocatorTy = std::allocator<VertexTy>,
+          size_t InlineCapacity = small_rrr_set_capacity<VertexTy>()>
+class SmallRRRset : private AllocatorTy {
+  static_assert(std::is_integral<VertexTy>::value,
+                "SmallRRRset stores integer vertex identifiers");
+  static_assert(InlineCapacity > 0, "The inline capacity must be positive");
+
+  using alloc_traits = std::allocator_traits<AllocatorTy>;
+
+ public:
+  using value_type = VertexTy;
+  using allocator_type = AllocatorTy;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = VertexTy &;
+  using const_reference = const VertexTy &;
+  using pointer = VertexTy *;
+  using const_pointer = const VertexTy *;
+  using iterator = VertexTy *;
+  using const_iterator = const VertexTy *;
+
+  SmallRRRset() : SmallRRRset(AllocatorTy()) {}
+  explicit SmallRRRset(const AllocatorTy &allocator)
+      : AllocatorTy(allocator),
+        data_(inline_),
+        size_(0),
+        capacity_(InlineCapacity) {}
+
+  template <typename Itr>
+  SmallRRRset(Itr B, Itr E, const AllocatorTy &allocator = AllocatorTy())
+      : SmallRRRset(allocator) {
+    assign(B, E);
+  }
+
+  SmallRRRset(const SmallRRRset &O)
+      : SmallRRRset(alloc_traits::select_on_container_copy_construction(
+            O.get_allocator())) {
+    assign(O.begin(), O.end());
+  }
+
+  SmallRRRset(SmallRRRset &&O) noexcept : SmallRRRset(O.get_allocator()) {
+    steal(O);
+  }
+
+  SmallRRRset &operator=(const SmallRRRset &O) {
+    if (this != &O) assign(O.begin(), O.end());
+    return *this;
+  }
+
+  SmallRRRset &operator=(SmallRRRset &&O) noexcept {
+    if (this != &O) {
+      release();
+      steal(O);
+    }
+    return *this;
+  }
+
+  ~SmallRRRset() { release(); }
+
+  allocator_type get_allocator() const {
+    return static_cast<const AllocatorTy &>(*this);
+  }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  const_iterator cbegin() const { return data_; }
+  const_iterator cend() const { return data_ + size_; }
+
+  VertexTy *data() { return data_; }
+  const VertexTy *data() const { return data_; }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+  //! True when the vertices are stored inside the object.
+  bool is_inline() const { return data_ == inline_; }
+
+  reference operator[](size_t i) { return data_[i]; }
+  const_reference operator[](size_t i) const { return data_[i]; }
+  reference front() { return data_[0]; }
+  const_reference front() const { return data_[0]; }
+  reference back() { return data_[size_ - 1]; }
+  const_reference back() const { return data_[size_ - 1]; }
+
+  void push_back(VertexTy v) {
+    if (size_ == capacity_) grow(2 * capacity_);
+    data_[size_++] = v;
+  }
+
+  void reserve(size_t n) {
+    if (n > capacity_) grow(n);
+  }
+
+  void resize(size_t n, VertexTy v = VertexTy()) {
+    reserve(n);
+    if (n > size_) std::fill(data_ + size_, data_ + n, v);
+    size_ = n;
+  }
+
+  void clear() { size_ = 0; }
+
+  //! Move the vertices back inline, or trim the heap buffer to size().
+  void shrink_to_fit() {
+    if (is_inline() || size_ == capacity_) return;
+    if (size_ <= InlineCapacity) {
+      VertexTy *old = data_;
+      size_t old_capacity = capacity_;
+      std::copy(old, old + size_, inline_);
+      data_ = inline_;
+      capacity_ = InlineCapacity;
+      alloc_traits::deallocate(*this, old, old_capacity);
+    } else {
+      reallocate(size_);
+    }
+  }
+
+  template <typename Itr>
+  void assign(Itr B, Itr E) {
+    size_t n = std::distance(B, E);
+    clear();
+    reserve(n);
+    std::copy(B, E, data_);
+    size_ = n;
+  }
+
+  void swap(SmallRRRset &O) noexcept {
+    if (!is_inline() && !O.is_inline()) {
+      std::swap(data_, O.data_);
+      std::swap(size_, O.size_);
+      std::swap(capacity_, O.capacity_);
+      return;
+    }
+    SmallRRRset tmp(std::move(O));
+    O = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  friend void swap(SmallRRRset &A, SmallRRRset &B) noexcept { A.swap(B); }
+
+  friend bool operator==(const SmallRRRset &A, const SmallRRRset &B) {
+    return std::equal(A.begin(), A.end(), B.begin(), B.end());
+  }
+  friend bool operator!=(const SmallRRRset &A, const SmallRRRset &B) {
+    return !(A == B);
+  }
+
+ private:
+  void grow(size_t n) { reallocate(std::max(n, 2 * capacity_)); }
+
+  void reallocate(size_t n) {
+    VertexTy *fresh = alloc_traits::allocate(*this, n);
+    std::copy(data_, data_ + size_, fresh);
+    release();
+    data_ = fresh;
+    capacity_ = n;
+  }
+
+  void release() {
+    if (!is_inline()) alloc_traits::deallocate(*this, data_, capacity_);
+    data_ = inline_;
+    capacity_ = InlineCapacity;
+  }
+
+  //! Take the vertices of O and leave it empty.  Requires an inline *this.
+  void steal(SmallRRRset &O) {
+    if (O.is_inline()) {
+      std::copy(O.begin(), O.end(), inline_);
+    } else {
+      data_ = O.data_;
+      capacity_ = O.capacity_;
+      O.data_ = O.inline_;
+      O.capacity_ = InlineCapacity;
+    }
+    size_ = O.size_;
+    O.size_ = 0;
+  }
+
+  VertexTy *data_;
+  size_t size_;
+  size_t capacity_;
+  VertexTy inline_[InlineCapacity];
+};
+
+}  // namespace ripples
+
+#endif  // RIPPLES_SMALL_RRR_SET_H
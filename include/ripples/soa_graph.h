@@ -0,0 +1,385 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_SOA_GRAPH_H
+#define RIPPLES_SOA_GRAPH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "ripples/graph.h"
+#include "ripples/utility.h"
+
+namespace ripples {
+
+//! \brief Fixed-point encoding of probabilities in [0, 1].
+//!
+//! A probability p is stored as round(p * max), where max is the largest
+//! value of StorageTy.  Values outside [0, 1] are clamped.  The products are
+//! computed in double precision, which represents max exactly up to 32 bits.
+//!
+//! \tparam StorageTy The unsigned integer type storing the probabilities.
+template <typename StorageTy>
+struct fixed_point_weight {
+  static_assert(std::is_unsigned<StorageTy>::value && sizeof(StorageTy) <= 4,
+                "fixed_point_weight needs an unsigned type of up to 32 bits");
+
+  //! The type stored in the weight array.
+  using storage_type = StorageTy;
+
+  //! The encoding of 1.0.
+  static constexpr double scale = double(std::numeric_limits<StorageTy>::max());
+
+  //! Encode a probability.
+  static StorageTy encode(float p) {
+    double q = std::llround(std::min(std::max(double(p), 0.0), 1.0) * scale);
+    return StorageTy(q < scale ? q : scale);
+  }
+  //! Decode a probability.
+  static float decode(StorageTy q) { return float(q * (1.0 / scale)); }
+};
+
+//! \brief An encoded weight, decoded only when it is read.
+//!
+//! The neighbor iterator of SoAGraph hands out the weights in this form, so
+//! that a traversal skipping an already visited neighbor does not pay for
+//! its decoding.
+//!
+//! \tparam WeightCodec The encoding of the weights.
+template <typename WeightCodec>
+class lazy_weight {
+ public:
+  explicit lazy_weight(const typename WeightCodec::storage_type *w) : w_(w) {}
+
+  //! Decode the weight.
+  operator float() const { return WeightCodec::decode(*w_); }
+
+ private:
+  const typename WeightCodec::storage_type *w_;
+};
+
+//! \brief IEEE 754 half precision encoding of the weights.
+struct half_float_weight {
+  //! The type stored in the weight array.
+  using storage_type = uint16_t;
+
+  //! Encode a weight, rounding to the nearest half.
+  static uint16_t encode(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint16_t sign = (x >> 16) & 0x8000;
+    int32_t exponent = int32_t((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = x & 0x7fffff;
+
+    if (exponent >= 31) return sign | 0x7c00;  // Overflow and infinities.
+    if (exponent <= 0) {
+      // Subnormal halves, or zero when too small.
+      if (exponent < -10) return sign;
+      mantissa |= 0x800000;
+      uint32_t shift = 14 - exponent;
+      uint32_t half = mantissa >> shift;
+      uint32_t rest = mantissa & ((1u << shift) - 1);
+      uint32_t halfway = 1u << (shift - 1);
+      if (rest > halfway || (rest == halfway && (half & 1))) ++half;
+      return sign | half;
+    }
+
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) ++half;
+    return sign | half;
+  }
+
+  //! Decode a weight.
+  static float decode(uint16_t h) {
+    uint32_t sign = uint32_t(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t x;
+    if (exponent == 0) {
+      if (mantissa == 0) {
+        x = sign;
+      } else {
+        // Normalize the subnormal half.
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400)) {
+          mantissa <<= 1;
+          --exponent;
+        }
+        x = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+      }
+    } else if (exponent == 31) {
+      x = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+      x = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+  }
+};
+
+//! \brief A weighted graph in CSR format with a structure-of-arrays layout.
+//!
+//! Destinations and weights are stored in two separate arrays, and weights are
+//! stored through a WeightCodec (e.g., 8 or 16 bits fixed-point probabilities
+//! or half floats).  With 32-bit vertices and 8-bit weights an edge takes 5
+//! bytes instead of the 8 of WeightedDestination.  Neighborhoods are visited
+//! through an iterator yielding decoded WeightedDestination values, so the
+//! graph is a drop-in replacement of Graph for the traversals of the sampling
+//! algorithms.
+//!
+//! \tparam VertexTy The integer type representing a vertex of the graph.
+//! \tparam WeightCodec The encoding of the weights.
+//! \tparam DirectionPolicy The policy encoding the graph direction with repect
+//!    of the original data.
+template <typename VertexTy,
+          typename WeightCodec = fixed_point_weight<uint16_t>,
+          typename DirectionPolicy = ForwardDirection<VertexTy>>
+class SoAGraph {
+ public:
+  //! The size type.
+  using size_type = size_t;
+  //! The type of an edge in the graph.
+  using edge_type = WeightedDestination<VertexTy, float>;
+  //! The integer type representing vertices in the graph.
+  using vertex_type = VertexTy;
+  //! The type stored in the weight array.
+  using weight_storage_type = typename WeightCodec::storage_type;
+
+  //! \brief Iterator over a neighbor list.
+  class NeighborIterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = edge_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const edge_type *;
+
+    //! \brief A neighbor whose weight is decoded when it is read.
+    //!
+    //! It is a WeightedDestination, so the sampling kernels accept it, and it
+    //! converts to the decoded edge_type.
+    struct reference
+        : public WeightedDestination<VertexTy, lazy_weight<WeightCodec>> {
+      reference(VertexTy v, const weight_storage_type *w)
+          : WeightedDestination<VertexTy, lazy_weight<WeightCodec>>(
+                v, lazy_weight<WeightCodec>(w)) {}
+
+      operator edge_type() const {
+        return edge_type(this->vertex, this->weight);
+      }
+    };
+
+    NeighborIterator(const VertexTy *vertex, const weight_storage_type *weight)
+        : vertex_(vertex), weight_(weight) {}
+
+    reference operator*() const { return reference(*vertex_, weight_); }
+
+    NeighborIterator &operator++() {
+      ++vertex_;
+      ++weight_;
+      return *this;
+    }
+
+    NeighborIterator operator++(int) {
+      NeighborIterator tmp(*this);
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const NeighborIterator &O) const {
+      return vertex_ == O.vertex_;
+    }
+    bool operator!=(const NeighborIterator &O) const { return !(*this == O); }
+
+   private:
+    const VertexTy *vertex_;
+    const weight_storage_type *weight_;
+  };
+
+  //! \brief The neighborhood of a vertex.
+  class Neighborhood {
+   public:
+    Neighborhood(NeighborIterator B, NeighborIterator E) : begin_(B), end_(E) {}
+
+    //! Begin of the neighborhood.
+    NeighborIterator begin() const { return begin_; }
+    //! End of the neighborhood.
+    NeighborIterator end() const { return end_; }
+
+   private:
+    NeighborIterator begin_;
+    NeighborIterator end_;
+  };
+
+  //! Empty Graph Constructor.
+  SoAGraph() : numNodes(0), numEdges(0) {}
+
+  //! \brief Convert a Graph to the structure-of-arrays layout.
+  //!
+  //! \tparam DestinationTy The type of the edges of the input graph.
+  //!
+  //! \param G The graph to be converted.
+  template <typename DestinationTy>
+  explicit SoAGraph(const Graph<VertexTy, DestinationTy, DirectionPolicy> &G)
+      : numNodes(G.num_nodes()),
+        numEdges(G.num_edges()),
+        index(G.num_nodes() + 1),
+        destinations(G.num_edges()),
+        weights(G.num_edges()),
+        reverseMap(G.num_nodes()) {
+    index[0] = 0;
+#pragma omp parallel for
+    for (size_t v = 0; v < numNodes; ++v) {
+      index[v + 1] = G.degree(v);
+      reverseMap[v] = G.convertID(v);
+    }
+    parallel_prefix_sum(index.begin(), index.end());
+    idMap = VertexIDMap<VertexTy>(reverseMap);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numNodes; ++v) {
+      size_t i = index[v];
+      for (auto u : G.neighbors(v)) {
+        destinations[i] = u.vertex;
+        weights[i] = WeightCodec::encode(u.weight);
+        ++i;
+      }
+    }
+  }
+
+  //! Returns the out-degree of a vertex.
+  //! \param v The input vertex.
+  //! \return the out-degree of vertex v in input.
+  size_t degree(VertexTy v) const { return index[v + 1] - index[v]; }
+
+  //! Returns the neighborhood of a vertex.
+  //! \param v The input vertex.
+  //! \return a range containing the out-neighbors of the vertex v in input.
+  Neighborhood neighbors(VertexTy v) const {
+    return Neighborhood(
+        NeighborIterator(destinations.data() + index[v],
+                         weights.data() + index[v]),
+        NeighborIterator(destinations.data() + index[v + 1],
+                         weights.data() + index[v + 1]));
+  }
+
+  //! The number of nodes in the Graph.
+  size_t num_nodes() const { return numNodes; }
+
+  //! The number of edges in the Graph.
+  size_t num_edges() const { return numEdges; }
+
+  //! The number of bytes used by the index, the destinations and the weights.
+  size_t memory_footprint() const {
+    return index.size() * sizeof(uint64_t) + numEdges * sizeof(VertexTy) +
+           numEdges * sizeof(weight_storage_type);
+  }
+
+  //! The destination array, as a dense stream of vertices.
+  const VertexTy *csr_destinations() const { return destinations.data(); }
+
+  //! The encoded weight array.
+  const weight_storage_type *csr_weights() const { return weights.data(); }
+
+  //! The CSR index, as offsets into the destination and weight arrays.
+  const uint64_t *csr_index() const { return index.data(); }
+
+  //! Convert a list of vertices from the interal representation to the original
+  //! input representation.
+  //!
+  //! \tparam Itr The iterator type of the input sequence of vertex IDs.
+  //! \tparam OutputItr The iterator type of the output sequence.
+  //!
+  //! \param b The begin of the input vertex IDs sequence.
+  //! \param e The end of the input vertex IDs sequence.
+  //! \param o The start of the output vertex IDs sequence.
+  template <typename Itr, typename OutputItr>
+  void convertID(Itr b, Itr e, OutputItr o) const {
+    using value_type = typename Itr::value_type;
+    std::transform(b, e, o, [&](const value_type &v) -> value_type {
+      return reverseMap.at(v);
+    });
+  }
+
+  //! Convert a vertex from the interal representation to the original input
+  //! representation.
+  //!
+  //! \param v The input vertex ID.
+  //! \return The original vertex ID in the input representation.
+  vertex_type convertID(const vertex_type v) const { return reverseMap.at(v); }
+
+  //! Convert a vertex from the original input representation to the internal
+  //! representation.
+  //!
+  //! \param v The original vertex ID.
+  //! \return The internal vertex ID.
+  vertex_type transformID(const vertex_type v) const {
+    vertex_type id;
+    if (idMap.find(v, id))
+      return id;
+    else
+      throw "Bad node";
+  }
+
+ private:
+  size_t numNodes;
+  size_t numEdges;
+
+  std::vector<uint64_t> index;
+  std::vector<VertexTy> destinations;
+  std::vector<weight_storage_type> weights;
+
+  VertexIDMap<VertexTy> idMap;
+  std::vector<VertexTy> reverseMap;
+};
+
+}  // namespace ripples
+
+#endif  // RIPPLES_SOA_GRAPH_H
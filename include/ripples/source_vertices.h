@@ -0,0 +1,110 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_SOURCE_VERTICES_H
+#define RIPPLES_SOURCE_VERTICES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ripples {
+
+//! \brief The RRR sets rooted at the vertices without in-edges.
+//!
+//! Such a root always yields the singleton {root}, which covers its root and
+//! nothing else.  The samplers count these sets here instead of sampling and
+//! storing them, and the seed selection pre-seeds its coverage counters with
+//! the counts.  The sets keep their slots, empty, so theta is unchanged.
+class SourceVertices {
+ public:
+  SourceVertices() = default;
+
+  //! \param G The transposed graph.
+  //! \param enabled If false no vertex is treated as a source: nothing is
+  //! counted and the counts stay zero.
+  template <typename GraphTy>
+  explicit SourceVertices(const GraphTy &G, bool enabled = true)
+      : source_(G.num_nodes()), counts_(G.num_nodes()) {
+    if (!enabled) return;
+#pragma omp parallel for reduction(+ : num_sources_)
+    for (size_t v = 0; v < G.num_nodes(); ++v) {
+      source_[v] = G.degree(v) == 0;
+      num_sources_ += source_[v];
+    }
+  }
+
+  //! \brief Count the RRR set of a root instead of sampling it, if the root
+  //! is a source.  Safe to call concurrently.
+  //!
+  //! \return true if the set was counted and must not be sampled.
+  bool count(size_t root) {
+    if (!source_[root]) return false;
+#pragma omp atomic
+    counts_[root] += 1;
+    return true;
+  }
+
+  //! \brief Count an RRR set instead of storing it, if it is the singleton
+  //! of a source.  Safe to call concurrently.
+  //!
+  //! \return true if the set was counted and can be dropped.
+  template <typename RRRset>
+  bool absorb(const RRRset &set) {
+    return set.size() == 1 && count(set[0]);
+  }
+
+  //! The number of vertices without in-edges.
+  size_t num_sources() const { return num_sources_; }
+
+  //! The number of RRR sets counted per vertex.
+  const std::vector<uint32_t> &counts() const { return counts_; }
+
+ private:
+  std::vector<char> source_;
+  std::vector<uint32_t> counts_;
+  size_t num_sources_{0};
+};
+
+}  // namespace ripples
+
+#endif /* RIPPLES_SOURCE_VERTICES_H */
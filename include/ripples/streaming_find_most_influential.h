@@ -61,10 +61,13 @@
 
 namespace ripples {
 
-template <typename GraphTy>
+//! \tparam GraphTy The graph type.
+//! \tparam RRRsetsTy The sequence of RRR sets: a vector of RRRset or the
+//!    index of an RRRStore.
+template <typename GraphTy, typename RRRsetsTy = RRRsets<GraphTy>>
 class FindMostInfluentialWorker {
  public:
-  using rrr_set_iterator = typename RRRsets<GraphTy>::iterator;
+  using rrr_set_iterator = typename RRRsetsTy::iterator;
   using vertex_type = typename GraphTy::vertex_type;
 
   virtual ~FindMostInfluentialWorker() {}
@@ -84,11 +87,12 @@ class FindMostInfluentialWorker {
 };
 
 #ifdef RIPPLES_ENABLE_CUDA
-template <typename GraphTy>
-class GPUFindMostInfluentialWorker : public FindMostInfluentialWorker<GraphTy> {
+template <typename GraphTy, typename RRRsetsTy = RRRsets<GraphTy>>
+class GPUFindMostInfluentialWorker
+    : public FindMostInfluentialWorker<GraphTy, RRRsetsTy> {
  public:
   using rrr_set_iterator =
-      typename FindMostInfluentialWorker<GraphTy>::rrr_set_iterator;
+      typename FindMostInfluentialWorker<GraphTy, RRRsetsTy>::rrr_set_iterator;
   using vertex_type = typename GraphTy::vertex_type;
 
   GPUFindMostInfluentialWorker(size_t device_number, size_t num_nodes,
@@ -283,11 +287,12 @@ class GPUFindMostInfluentialWorker : public FindMostInfluentialWorker<GraphTy> {
 
 #endif
 
-template <typename GraphTy>
-class CPUFindMostInfluentialWorker : public FindMostInfluentialWorker<GraphTy> {
+template <typename GraphTy, typename RRRsetsTy = RRRsets<GraphTy>>
+class CPUFindMostInfluentialWorker
+    : public FindMostInfluentialWorker<GraphTy, RRRsetsTy> {
   using vertex_type = typename GraphTy::vertex_type;
   using rrr_set_iterator =
-      typename FindMostInfluentialWorker<GraphTy>::rrr_set_iterator;
+      typename FindMostInfluentialWorker<GraphTy, RRRsetsTy>::rrr_set_iterator;
 
  public:
   CPUFindMostInfluentialWorker(
@@ -325,7 +330,7 @@ class CPUFindMostInfluentialWorker : public FindMostInfluentialWorker<GraphTy> {
   void UpdateCounters(vertex_type last_seed) {
     if (!has_work()) return;
 
-    auto cmp = [=](const RRRset<GraphTy> &a) -> auto {
+    auto cmp = [=](const typename RRRsetsTy::value_type &a) -> auto {
       return !std::binary_search(a.begin(), a.end(), last_seed); 
     };
 
@@ -373,16 +378,16 @@ struct CompareHeap {
   }
 };
 
-template <typename GraphTy>
+template <typename GraphTy, typename RRRsetsTy = RRRsets<GraphTy>>
 class StreamingFindMostInfluential {
   using vertex_type = typename GraphTy::vertex_type;
-  using worker_type = FindMostInfluentialWorker<GraphTy>;
-  using cpu_worker_type = CPUFindMostInfluentialWorker<GraphTy>;
+  using worker_type = FindMostInfluentialWorker<GraphTy, RRRsetsTy>;
+  using cpu_worker_type = CPUFindMostInfluentialWorker<GraphTy, RRRsetsTy>;
 #ifdef RIPPLES_ENABLE_CUDA
-  using gpu_worker_type = GPUFindMostInfluentialWorker<GraphTy>;
+  using gpu_worker_type = GPUFindMostInfluentialWorker<GraphTy, RRRsetsTy>;
 #endif
   using rrr_set_iterator =
-      typename FindMostInfluentialWorker<GraphTy>::rrr_set_iterator;
+      typename FindMostInfluentialWorker<GraphTy, RRRsetsTy>::rrr_set_iterator;
 
   CompareHeap<GraphTy> cmpHeap;
   using priorityQueue =
@@ -391,7 +396,7 @@ class StreamingFindMostInfluential {
                           decltype(cmpHeap)>;
 
  public:
-  StreamingFindMostInfluential(const GraphTy &G, RRRsets<GraphTy> &RRRsets,
+  StreamingFindMostInfluential(const GraphTy &G, RRRsetsTy &RRRsets,
                                size_t num_max_cpus, size_t num_gpus)
       : num_cpu_workers_(num_max_cpus),
         num_gpu_workers_(num_gpus),
@@ -425,7 +430,7 @@ class StreamingFindMostInfluential {
       }
     }
 #endif
-    workers_.push_back(new CPUFindMostInfluentialWorker<GraphTy>(
+    workers_.push_back(new cpu_worker_type(
         vertex_coverage_, queue_storage_, RRRsets_.begin(), RRRsets_.end(),
         num_cpu_workers_, d_cpu_counters_));
 #ifdef RIPPLES_ENABLE_CUDA
@@ -441,7 +446,7 @@ class StreamingFindMostInfluential {
 
       uint32_t *dest = i == 0 ? d_cpu_counters_ : d_counters_[tree[i].first];
 
-      workers_.push_back(new GPUFindMostInfluentialWorker<GraphTy>(
+      workers_.push_back(new gpu_worker_type(
           i, G.num_nodes(), d_counters_, tree[i].first, tree[i].second, dest));
     }
 #endif
@@ -604,7 +609,7 @@ class StreamingFindMostInfluential {
  private:
   size_t num_cpu_workers_, num_gpu_workers_;
   ssize_t reduction_steps_;
-  RRRsets<GraphTy> &RRRsets_;
+  RRRsetsTy &RRRsets_;
   std::vector<worker_type *> workers_;
   std::vector<uint32_t *> d_counters_;
   uint32_t *d_cpu_counters_;
@@ -44,6 +44,7 @@
 #include <atomic>
 #include <cassert>
 #include <cstdlib>
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <unordered_map>
@@ -60,8 +61,15 @@
 
 #include "trng/uniform_int_dist.hpp"
 
+#include "ripples/count_statistics.h"
+#include "ripples/counter_rng.h"
+#include "ripples/diffusion_simulation.h"
 #include "ripples/imm_execution_record.h"
+#include "ripples/live_edge_world.h"
 #include "ripples/huffman.h"
+#include "ripples/sampling_scratch.h"
+#include "ripples/source_vertices.h"
+#include "ripples/work_stealing.h"
 
 #ifdef RIPPLES_ENABLE_CUDA
 #include "ripples/cuda/cuda_generate_rrr_sets.h"
@@ -148,17 +156,62 @@ class WalkWorker {
   using vertex_t = typename GraphTy::vertex_type;
 
  public:
+  //! Called by a worker on each chunk of RRR sets it has just sampled.  The
+  //! slots of the samples deferred to all the workers are still empty.
+  using chunk_sink = std::function<void(ItrTy, ItrTy)>;
+
   WalkWorker(const GraphTy &G) : G_(G) {}
   virtual ~WalkWorker() {}
-  virtual void svc_loop(std::atomic<size_t> &mpmc_head, ItrTy begin,
-                        ItrTy end) = 0;
-  virtual void svc_loop3(std::atomic<size_t> &mpmc_head, ItrTy begin,
-                        ItrTy end, size_t myrank) = 0;
+  //! Sample the chunks handed out by the scheduler, offsets from begin.
+  virtual void svc_loop(WorkStealingScheduler &scheduler, size_t rank,
+                        ItrTy begin) = 0;
+  virtual void svc_loop3(WorkStealingScheduler &scheduler, size_t rank,
+                         ItrTy begin, const chunk_sink &sink = chunk_sink()) = 0;
   virtual uint32_t wkrGlobalCnt(int i) = 0;
   virtual void freeGlobalCnt() = 0;
+
+  //! Set the index of the first sample of the next range to generate.
+  void sample_base(size_t base) { sample_base_ = base; }
+
+  //! The vertex counters of the worker, empty if it does not count.
+  const std::vector<uint32_t> &global_counts() const { return globalcnt_; }
+
+  //! A sample whose frontier outgrew the giant threshold, to be completed by
+  //! all the workers.
+  struct GiantSample {
+    size_t offset;                   //!< The position in the range.
+    std::vector<vertex_t> set;       //!< The vertices reached so far.
+    std::vector<vertex_t> frontier;  //!< The vertices left to expand.
+  };
+
+  //! The giant samples deferred by the worker in the current range.
+  std::vector<GiantSample> &giant_samples() { return giant_samples_; }
+
+  //! \brief Take part in the expansion of one level of a giant sample.
+  //!
+  //! \param frontier The vertices of the level.
+  //! \param next The index of the next unclaimed vertex of the level.
+  //! \param visited The vertices of the sample.
+  //! \param out The vertices of the next level found by this worker.
+  virtual void expand_frontier(const std::vector<vertex_t> & /* frontier */,
+                               std::atomic<size_t> & /* next */,
+                               AtomicVisitedSet & /* visited */,
+                               std::vector<vertex_t> & /* out */) {}
+
+  //! \brief Count the samples rooted at sources instead of sampling them.
+  //!
+  //! The workers that support it leave the slots of these samples empty.
+  //! The others sample them as usual, for the chunk sink to absorb.
+  //!
+  //! \param sources The counters, or nullptr to sample every root.
+  void count_sources(SourceVertices *sources) { sources_ = sources; }
+
  protected:
   const GraphTy &G_;
   std::vector<uint32_t> globalcnt_;
+  size_t sample_base_{0};
+  std::vector<GiantSample> giant_samples_;
+  SourceVertices *sources_{nullptr};
 
 #if CUDA_PROFILE
  public:
@@ -174,37 +227,73 @@ class CPUWalkWorker : public WalkWorker<GraphTy, ItrTy> {
   using vertex_t = typename GraphTy::vertex_type;
 
  public:
-  CPUWalkWorker(const GraphTy &G, const PRNGeneratorTy &rng)
-      : WalkWorker<GraphTy, ItrTy>(G), rng_(rng), u_(0, G.num_nodes()) {}
-  
-  void svc_loop(std::atomic<size_t> &mpmc_head, ItrTy begin, ItrTy end) {
-    size_t offset = 0;
-    while ((offset = mpmc_head.fetch_add(batch_size_)) <
-           std::distance(begin, end)) {
+  //! \param G The graph.
+  //! \param rng The random number generator of the worker.
+  //! \param batched Sample RRR sets in batches of 64 with AddRRRSetBatch:
+  //! bit-parallel traversals under IC, interleaved walks under LT.
+  //! \param giant_frontier Defer the IC samples whose frontier grows past
+  //! this size to all the workers, 0 to never defer.
+  //! \param sets_per_world Read this many IC RRR sets from each sampled
+  //! live-edge world, 0 to sample every set on its own.
+  CPUWalkWorker(const GraphTy &G, const PRNGeneratorTy &rng,
+                bool batched = false, size_t giant_frontier = 0,
+                size_t sets_per_world = 0)
+      : WalkWorker<GraphTy, ItrTy>(G),
+        rng_(rng),
+        u_(0, G.num_nodes()),
+        batched_(batched),
+        giant_frontier_(std::is_same<diff_model_tag,
+                                     independent_cascade_tag>::value
+                            ? giant_frontier
+                            : 0),
+        sets_per_world_(std::is_same<diff_model_tag,
+                                     independent_cascade_tag>::value
+                            ? sets_per_world
+                            : 0) {}
+
+  void svc_loop(WorkStealingScheduler &scheduler, size_t rank, ItrTy begin) {
+    size_t offset, offset_end;
+    while (scheduler.next(rank, chunk_size(), offset, offset_end)) {
       auto first = begin;
       std::advance(first, offset);
-      auto last = first;
-      std::advance(last, batch_size_);
-      if (last > end) last = end;
-      batch(first, last);
+      auto last = begin;
+      std::advance(last, offset_end);
+      if (sets_per_world_)
+        world_walks(first, last, this->sample_base_ + offset);
+      else if (batched_)
+        batched_walks(first, last, this->sample_base_ + offset);
+      else
+        batch(first, last, this->sample_base_ + offset);
+      observe(first, last);
     }
   }
 
-  void svc_loop3(std::atomic<size_t> &mpmc_head, ItrTy begin, ItrTy end, size_t myrank) {
-    size_t offset = 0;
+  void svc_loop3(WorkStealingScheduler &scheduler, size_t myrank, ItrTy begin,
+                 const typename WalkWorker<GraphTy, ItrTy>::chunk_sink &sink =
+                     {}) {
+    size_t offset, offset_end;
     size_t workload=0;
     this->globalcnt_.resize(this->G_.num_nodes());
     for(int i=0;i<this->G_.num_nodes();i++){
       this->globalcnt_[i]=0;
     }
-    while ((offset = mpmc_head.fetch_add(batch_size_)) <
-           std::distance(begin, end)) {
+    while (scheduler.next(myrank, chunk_size(), offset, offset_end)) {
       auto first = begin;
       std::advance(first, offset);
-      auto last = first;
-      std::advance(last, batch_size_);
-      if (last > end) last = end;
-      batch2(first, last, this->globalcnt_);
+      auto last = begin;
+      std::advance(last, offset_end);
+      if (batched_ || sets_per_world_) {
+        if (sets_per_world_)
+          world_walks(first, last, this->sample_base_ + offset);
+        else
+          batched_walks(first, last, this->sample_base_ + offset);
+        for (auto itr = first; itr != last; ++itr)
+          for (auto v : *itr) this->globalcnt_[v] += 1;
+      } else {
+        batch2(first, last, this->globalcnt_, this->sample_base_ + offset);
+      }
+      observe(first, last);
+      if (sink) sink(first, last);
       workload+=std::distance(first, last);
     }
     if(workload==0){
@@ -216,27 +305,151 @@ class CPUWalkWorker : public WalkWorker<GraphTy, ItrTy> {
     return this->globalcnt_[i];
   }
 
+  void expand_frontier(const std::vector<vertex_t> &frontier,
+                       std::atomic<size_t> &next, AtomicVisitedSet &visited,
+                       std::vector<vertex_t> &out) {
+    ExpandRRRFrontier(this->G_, frontier, next, rng_, visited, out);
+  }
+
   void freeGlobalCnt(){
     this->globalcnt_.clear();
     this->globalcnt_.shrink_to_fit();
   }
 
  private:
-  static constexpr size_t batch_size_ = 2;
+  //! The chunk size until the first RRR sets have been measured.
+  static constexpr size_t initial_chunk_ = 64;
+  //! The number of vertices a chunk should add to the RRR sets.
+  static constexpr size_t chunk_vertices_ = 1 << 14;
+  static constexpr size_t max_chunk_ = 1 << 12;
   PRNGeneratorTy rng_;
   trng::uniform_int_dist u_;
+  bool batched_;
+  size_t giant_frontier_;
+  size_t sets_per_world_;
+  LiveEdgeWorld<vertex_t> world_;
+  std::vector<vertex_t> world_roots_;
+  size_t num_sets_{0};
+  size_t num_vertices_{0};
+  std::vector<vertex_t> buffer_;
+  std::vector<vertex_t> frontier_;
+
+  //! \brief Sample an IC RRR set, deferring it to all the workers if its
+  //! frontier grows past giant_frontier_.
+  //!
+  //! \return true if the sample is complete and stored in the slot.
+  template <typename SlotTy>
+  bool sample_bounded(vertex_t root, PRNGeneratorTy &rng, SlotTy &&slot,
+                      size_t index) {
+    buffer_.clear();
+    frontier_.clear();
+    if (AddRRRSetBounded(this->G_, root, rng, buffer_, frontier_,
+                         giant_frontier_)) {
+      slot.assign(buffer_.begin(), buffer_.end());
+      return true;
+    }
+    this->giant_samples_.push_back(
+        {index - this->sample_base_, buffer_, frontier_});
+    return false;
+  }
 
-  void batch(ItrTy first, ItrTy last) {
+  //! \brief The number of samples to take from the scheduler at once.
+  //!
+  //! Chunks carry about the same amount of work: chunk_vertices_ vertices at
+  //! the mean RRR set size observed so far, rounded to whole batches or
+  //! worlds.
+  size_t chunk_size() const {
+    size_t granularity = sets_per_world_ ? sets_per_world_
+                         : batched_      ? bit_parallel_batch_size
+                                         : 1;
+    size_t chunk = initial_chunk_;
+    if (num_sets_ != 0)
+      chunk = chunk_vertices_ * num_sets_ / std::max(num_vertices_, size_t(1));
+    chunk = std::min(std::max(chunk, size_t(1)), size_t(max_chunk_));
+    return (chunk + granularity - 1) / granularity * granularity;
+  }
+
+  //! Account for the RRR sets of a chunk in the mean RRR set size.
+  void observe(ItrTy first, ItrTy last) {
+    for (; first != last; ++first) {
+      num_vertices_ += (*first).size();
+      ++num_sets_;
+    }
+  }
+
+  void batched_walks(ItrTy first, ItrTy last, size_t index) {
 #if CUDA_PROFILE
     auto start = std::chrono::high_resolution_clock::now();
 #endif
     auto size = std::distance(first, last);
     auto local_rng = rng_;
     auto local_u = u_;
-    for (;first != last; ++first) {
+    vertex_t roots[bit_parallel_batch_size];
+    while (first != last) {
+      size_t count = std::min<size_t>(bit_parallel_batch_size,
+                                      std::distance(first, last));
+      seek_sample(local_rng, index);
+      index += count;
+      for (size_t i = 0; i < count; ++i) roots[i] = local_u(local_rng);
+
+      AddRRRSetBatch(this->G_, roots, count, local_rng, first,
+                     diff_model_tag{});
+      std::advance(first, count);
+    }
+
+    rng_ = local_rng;
+    u_ = local_u;
+#if CUDA_PROFILE
+    auto &p(prof_bd.back());
+    p.d_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+    p.n_ += size;
+#endif
+  }
+
+  //! \brief Sample the RRR sets of a chunk from live-edge worlds.
+  //!
+  //! Every sets_per_world_ consecutive samples share a world, drawn from the
+  //! random stream of the first of them.  The chunks start at multiples of
+  //! sets_per_world_, so the worlds do not depend on the schedule.
+  void world_walks(ItrTy first, ItrTy last, size_t index) {
+    auto local_rng = rng_;
+    auto local_u = u_;
+    while (first != last) {
+      size_t count = std::min<size_t>(sets_per_world_,
+                                      std::distance(first, last));
+      seek_sample(local_rng, index);
+      index += count;
+      world_roots_.resize(count);
+      for (auto &r : world_roots_) r = local_u(local_rng);
+
+      SampleLiveEdgeWorld(this->G_, local_rng, world_);
+      for (auto r : world_roots_) {
+        world_.rrr_set(r, buffer_);
+        (*first).assign(buffer_.begin(), buffer_.end());
+        ++first;
+      }
+    }
+
+    rng_ = local_rng;
+    u_ = local_u;
+  }
+
+  void batch(ItrTy first, ItrTy last, size_t index) {
+#if CUDA_PROFILE
+    auto start = std::chrono::high_resolution_clock::now();
+#endif
+    auto size = std::distance(first, last);
+    auto local_rng = rng_;
+    auto local_u = u_;
+    for (;first != last; ++first, ++index) {
+      seek_sample(local_rng, index);
       vertex_t root = local_u(local_rng);
 
-      AddRRRSet(this->G_, root, local_rng, *first, diff_model_tag{});
+      if (giant_frontier_ != 0)
+        sample_bounded(root, local_rng, *first, index);
+      else
+        AddRRRSet(this->G_, root, local_rng, *first, diff_model_tag{});
     }
 
     rng_ = local_rng;
@@ -249,18 +462,32 @@ class CPUWalkWorker : public WalkWorker<GraphTy, ItrTy> {
 #endif
   }
 
-  void batch2(ItrTy first, ItrTy last, std::vector<uint32_t> &globalcnt) {
+  void batch2(ItrTy first, ItrTy last, std::vector<uint32_t> &globalcnt,
+              size_t index) {
 #if CUDA_PROFILE
     auto start = std::chrono::high_resolution_clock::now();
 #endif
     auto size = std::distance(first, last);
     size_t batch_progress=0;
     double vm1;
-    thread_local auto local_rng = rng_;
-    thread_local auto local_u = u_;
+    auto local_rng = rng_;
+    auto local_u = u_;
     while (first != last) {
+      size_t sample = index++;
+      seek_sample(local_rng, sample);
       vertex_t root = local_u(local_rng);
-      AddRRRSet2(this->G_, root, local_rng, *first, diff_model_tag{});
+      if (this->sources_ && this->sources_->count(root)) {
+        globalcnt[root] += 1;
+        ++first;
+        continue;
+      }
+      if (giant_frontier_ == 0) {
+        AddRRRSet2(this->G_, root, local_rng, *first, diff_model_tag{});
+      } else if (!sample_bounded(root, local_rng, *first, sample)) {
+        ++first;
+        continue;
+      }
+      (*first).shrink_to_fit();
       if((*first).size()<1){
         (*first).clear();
       }
@@ -390,17 +617,15 @@ class GPUWalkWorker<GraphTy, PRNGeneratorTy, ItrTy, linear_threshold_tag>
                       conf_.max_blocks_, conf_.block_size_);
   }
 
-  void svc_loop(std::atomic<size_t> &mpmc_head, ItrTy begin, ItrTy end) {
+  void svc_loop(WorkStealingScheduler &scheduler, size_t rank, ItrTy begin) {
     cuda_set_device(cuda_ctx_->gpu_id);
-    size_t offset = 0;
+    size_t offset, offset_end;
     auto batch_size = conf_.num_gpu_threads();
-    while ((offset = mpmc_head.fetch_add(batch_size)) <
-           std::distance(begin, end)) {
+    while (scheduler.next(rank, batch_size, offset, offset_end)) {
       auto first = begin;
       std::advance(first, offset);
-      auto last = first;
-      std::advance(last, batch_size);
-      if (last > end) last = end;
+      auto last = begin;
+      std::advance(last, offset_end);
       batch(first, last);
     }
   }
@@ -415,6 +640,7 @@ class GPUWalkWorker<GraphTy, PRNGeneratorTy, ItrTy, linear_threshold_tag>
   // memory buffers
   mask_word_t *lt_res_mask_, *d_lt_res_mask_;
   PRNGeneratorTy *d_trng_state_;
+  std::vector<vertex_t> rrr_set_;
 
   void batch(ItrTy first, ItrTy last) {
 #if CUDA_PROFILE
@@ -461,27 +687,26 @@ class GPUWalkWorker<GraphTy, PRNGeneratorTy, ItrTy, linear_threshold_tag>
 #endif
 
     for (size_t i = 0; i < batch_size; ++i, ++first) {
-      auto &rrr_set(*first);
-      rrr_set.reserve(conf_.mask_words_);
       auto res_mask = lt_res_mask_ + (i * conf_.mask_words_);
       if (res_mask[0] != this->G_.num_nodes()) {
         // valid walk
+        rrr_set_.clear();
         for (size_t j = 0;
              j < conf_.mask_words_ && res_mask[j] != this->G_.num_nodes();
              ++j) {
-          rrr_set.push_back(res_mask[j]);
+          rrr_set_.push_back(res_mask[j]);
         }
+        std::stable_sort(rrr_set_.begin(), rrr_set_.end());
+        (*first).assign(rrr_set_.begin(), rrr_set_.end());
       } else {
 // invalid walk
 #if CUDA_PROFILE
         p.num_exceedings_++;
 #endif
         auto root = res_mask[1];
-        AddRRRSet(this->G_, root, rng_, rrr_set,
+        AddRRRSet(this->G_, root, rng_, *first,
                   ripples::linear_threshold_tag{});
       }
-
-      std::stable_sort(rrr_set.begin(), rrr_set.end());
     }
   }
 
@@ -604,18 +829,16 @@ class GPUWalkWorker<GraphTy, PRNGeneratorTy, ItrTy, independent_cascade_tag>
     solver_->rng(d_trng_state_);
   }
 
-  void svc_loop(std::atomic<size_t> &mpmc_head, ItrTy begin, ItrTy end) {
+  void svc_loop(WorkStealingScheduler &scheduler, size_t rank, ItrTy begin) {
     // set device and stream
     cuda_set_device(cuda_ctx_->gpu_id);
 
-    size_t offset = 0;
-    while ((offset = mpmc_head.fetch_add(batch_size_)) <
-           std::distance(begin, end)) {
+    size_t offset, offset_end;
+    while (scheduler.next(rank, batch_size_, offset, offset_end)) {
       auto first = begin;
       std::advance(first, offset);
-      auto last = first;
-      std::advance(last, batch_size_);
-      if (last > end) last = end;
+      auto last = begin;
+      std::advance(last, offset_end);
       batch(first, last);
     }
   }
@@ -637,6 +860,7 @@ class GPUWalkWorker<GraphTy, PRNGeneratorTy, ItrTy, independent_cascade_tag>
   typename cuda_device_graph<GraphTy>::vertex_t *ic_predecessors_,
       *d_ic_predecessors_;
   PRNGeneratorTy *d_trng_state_;
+  std::vector<vertex_t> rrr_set_;
 
   void batch(ItrTy first, ItrTy last) {
 #if CUDA_PROFILE
@@ -684,9 +908,10 @@ class GPUWalkWorker<GraphTy, PRNGeneratorTy, ItrTy, independent_cascade_tag>
   }
 
   void ic_build(ItrTy dst) {
-    auto &rrr_set(*dst);
+    rrr_set_.clear();
     for (vertex_t i = 0; i < this->G_.num_nodes(); ++i)
-      if (ic_predecessors_[i] != -1) rrr_set.push_back(i);
+      if (ic_predecessors_[i] != -1) rrr_set_.push_back(i);
+    (*dst).assign(rrr_set_.begin(), rrr_set_.end());
   }
 
 #if CUDA_PROFILE
@@ -745,11 +970,21 @@ class StreamingRRRGenerator {
   StreamingRRRGenerator(const GraphTy &G, const PRNGeneratorTy &master_rng,
                         IMMExecutionRecord &record, size_t num_cpu_workers,
                         size_t num_gpu_workers,
-                        const std::unordered_map<size_t, size_t> &worker_to_gpu)
+                        const std::unordered_map<size_t, size_t> &worker_to_gpu,
+                        bool batched_walks = false, size_t giant_frontier = 0,
+                        size_t sets_per_world = 0)
       : num_cpu_workers_(num_cpu_workers),
         num_gpu_workers_(num_gpu_workers),
         record_(record),
-        console(spdlog::stdout_color_st("Streaming Generator")) {
+        console(spdlog::stdout_color_st("Streaming Generator")),
+        scheduler_(num_cpu_workers + num_gpu_workers),
+        granularity_(std::is_same<diff_model_tag,
+                                  independent_cascade_tag>::value &&
+                             sets_per_world
+                         ? sets_per_world
+                     : batched_walks ? bit_parallel_batch_size
+                                     : 1),
+        num_nodes_(G.num_nodes()) {
 #ifdef RIPPLES_ENABLE_CUDA
     // init GPU contexts
     for (auto &m : worker_to_gpu) {
@@ -802,8 +1037,9 @@ class StreamingRRRGenerator {
         // console->info("> mapping: omp={}\t->\tCPU", omp_num);
         // console->info("cpu_worker_id = {}", cpu_worker_id);
         auto rng = master_rng;
-        rng.split(num_rng_sequences, cpu_worker_id);
-        workers.push_back(new cpu_worker_t(G, rng));
+        split_worker_rng(rng, num_rng_sequences, cpu_worker_id);
+        workers.push_back(new cpu_worker_t(G, rng, batched_walks, giant_frontier,
+                                          sets_per_world));
         ++cpu_worker_id;
       }
     }
@@ -820,7 +1056,10 @@ class StreamingRRRGenerator {
         cuda_contexts_(std::move(O.cuda_contexts_)),
 #endif
         workers(std::move(O.workers)),
-        mpmc_head(O.mpmc_head.load()),
+        scheduler_(std::move(O.scheduler_)),
+        granularity_(O.granularity_),
+        num_nodes_(O.num_nodes_),
+        num_sampled_(O.num_sampled_),
 #if CUDA_PROFILE
         prof_bd(std::move(O.prof_bd)),
 #endif
@@ -870,6 +1109,13 @@ class StreamingRRRGenerator {
 
   IMMExecutionRecord &execution_record() { return record_; }
 
+  //! \brief Count the samples rooted at sources instead of sampling them.
+  //!
+  //! \param sources The counters, or nullptr to sample every root.
+  void count_sources(SourceVertices *sources) {
+    for (auto &w : workers) w->count_sources(sources);
+  }
+
   void generate(ItrTy begin, ItrTy end) {
 #if CUDA_PROFILE
     auto start = std::chrono::high_resolution_clock::now();
@@ -877,14 +1123,18 @@ class StreamingRRRGenerator {
     record_.WalkIterations.emplace_back();
 #endif
 
-    mpmc_head.store(0);
+    scheduler_.reset(std::distance(begin, end), granularity_);
+    for (auto &w : workers) w->sample_base(num_sampled_);
+    num_sampled_ += std::distance(begin, end);
     double vm1,vm2;
     process_mem_usage(vm1);
 #pragma omp parallel num_threads(num_cpu_workers_ + num_gpu_workers_)
     {
       size_t rank = omp_get_thread_num();
-      workers[rank]->svc_loop(mpmc_head, begin, end);
+      workers[rank]->svc_loop(scheduler_, rank, begin);
+      expand_giant_samples(rank);
     }
+    store_giant_samples(begin, nullptr);
     process_mem_usage(vm2);
     std::cout << "se.generate:("<<num_cpu_workers_<<") threads using: " << vm1<<","<<vm2 << " Mb" <<std::endl; 
 #if CUDA_PROFILE
@@ -899,36 +1149,40 @@ class StreamingRRRGenerator {
 #endif
   }
   
-  void generate2(ItrTy begin, ItrTy end, std::vector<uint32_t> &globalcnt, vertex_t* maxvtx) {
+  //! \brief Generate RRR sets and count the occurrences of the vertices.
+  //!
+  //! \param begin The start of the range of RRR sets.
+  //! \param end The end of the range of RRR sets.
+  //! \param globalcnt The vertex counters, incremented.
+  //! \param maxvtx The most frequent vertex.
+  //! \param stats The statistics of the counters to compute, if any.
+  //! \param sink Called on the RRR sets as soon as they are sampled, by the
+  //! thread that sampled them.
+  void generate2(ItrTy begin, ItrTy end, std::vector<uint32_t> &globalcnt,
+                 vertex_t *maxvtx, CountStatistics *stats = nullptr,
+                 const typename worker_t::chunk_sink &sink = {}) {
 #if CUDA_PROFILE
     auto start = std::chrono::high_resolution_clock::now();
     for (auto &w : workers) w->begin_prof_iter();
     record_.WalkIterations.emplace_back();
 #endif
 
-    mpmc_head.store(0);
+    scheduler_.reset(std::distance(begin, end), granularity_);
+    for (auto &w : workers) w->sample_base(num_sampled_);
+    num_sampled_ += std::distance(begin, end);
     double vm1,vm2;
     process_mem_usage(vm1);
 #pragma omp parallel num_threads(num_cpu_workers_ + num_gpu_workers_)
     {
       size_t rank = omp_get_thread_num();
-      workers[rank]->svc_loop3(mpmc_head, begin, end, rank);
+      workers[rank]->svc_loop3(scheduler_, rank, begin, sink);
+      expand_giant_samples(rank);
     }
-    size_t num_threads = omp_get_max_threads();
+    size_t num_threads = workers.size();
     std::cout<<" num-threads="<<num_threads<<" global-cnt.size="<<globalcnt.size()<<std::endl;
-    for(int i = 0; i<num_threads; i++){
-      for(int j=0; j<globalcnt.size(); j++){
-        globalcnt[j] += workers[i]->wkrGlobalCnt(j);
-      }
-      workers[i]->freeGlobalCnt();
-    }
-    size_t maxfreq=0;
-    for(int j=0; j<globalcnt.size(); j++){
-      if(globalcnt[j]>=maxfreq){
-        maxfreq=globalcnt[j];
-        *maxvtx = j;
-      }
-    }
+    store_giant_samples(begin, &globalcnt, sink);
+    size_t maxfreq = reduce_counts(globalcnt, maxvtx, stats);
+    for (auto &w : workers) w->freeGlobalCnt();
     process_mem_usage(vm2);
     std::cout << "se.generate:("<<num_cpu_workers_<<") threads, "<<workers.size()<<
       "workers. Using: " << vm1<<","<<vm2 << " Mb" << " maxvtx=" <<*maxvtx<<" maxfreq="<<maxfreq<<std::endl; 
@@ -947,6 +1201,135 @@ class StreamingRRRGenerator {
   bool isGpuEnabled() const { return num_gpu_workers_ != 0; }
 
  private:
+  //! \brief Complete the giant samples of all the workers, level by level.
+  //!
+  //! Called by every thread of the pool once its svc_loop is over.  The
+  //! frontier of every level is expanded by all the workers, which mark the
+  //! vertices they reach in a shared atomic visited set.
+  //!
+  //! \param rank The rank of the calling worker.
+  void expand_giant_samples(size_t rank) {
+#pragma omp barrier
+#pragma omp single
+    {
+      giants_.clear();
+      for (auto &w : workers)
+        for (auto &giant : w->giant_samples()) giants_.push_back(&giant);
+      next_level_.resize(workers.size());
+    }
+
+    for (auto *giant : giants_) {
+#pragma omp single
+      {
+        visited_.reset(num_nodes_);
+        for (auto v : giant->set) visited_.insert(v);
+      }
+      while (!giant->frontier.empty()) {
+#pragma omp single
+        next_vertex_.store(0);
+
+        next_level_[rank].clear();
+        workers[rank]->expand_frontier(giant->frontier, next_vertex_,
+                                       visited_, next_level_[rank]);
+#pragma omp barrier
+#pragma omp single
+        {
+          giant->frontier.clear();
+          for (auto &level : next_level_) {
+            giant->frontier.insert(giant->frontier.end(), level.begin(),
+                                   level.end());
+            giant->set.insert(giant->set.end(), level.begin(), level.end());
+          }
+        }
+      }
+    }
+  }
+
+  //! \brief Add the counters of the workers to globalcnt.
+  //!
+  //! The vertex range is cut in blocks that fit in the L1 cache and the
+  //! blocks are spread over the threads: a thread adds the counters of all
+  //! the workers to a block, then scans it for the most frequent vertex and
+  //! for the statistics while it is still in cache.
+  //!
+  //! \param globalcnt The vertex counters.
+  //! \param maxvtx The most frequent vertex, the last one in case of ties.
+  //! \param stats The statistics to compute, if any.
+  //! \return the count of the most frequent vertex.
+  uint32_t reduce_counts(std::vector<uint32_t> &globalcnt, vertex_t *maxvtx,
+                         CountStatistics *stats) {
+    constexpr size_t block_size = 4096;
+    struct partial_t {
+      bool found{false};
+      uint32_t maxfreq{0};
+      size_t argmax{0};
+      CountStatistics stats;
+    };
+
+    std::vector<const uint32_t *> counts;
+    for (auto &w : workers)
+      if (!w->global_counts().empty())
+        counts.push_back(w->global_counts().data());
+
+    size_t num_vertices = globalcnt.size();
+    size_t num_blocks = (num_vertices + block_size - 1) / block_size;
+    uint32_t *total = globalcnt.data();
+    std::vector<partial_t> partials(workers.size());
+#pragma omp parallel num_threads(workers.size())
+    {
+      auto &partial = partials[omp_get_thread_num()];
+#pragma omp for schedule(static)
+      for (size_t b = 0; b < num_blocks; ++b) {
+        size_t first = b * block_size;
+        size_t last = std::min(num_vertices, first + block_size);
+        for (auto c : counts)
+          for (size_t v = first; v < last; ++v) total[v] += c[v];
+
+        for (size_t v = first; v < last; ++v) {
+          if (total[v] >= partial.maxfreq) {
+            partial.maxfreq = total[v];
+            partial.argmax = v;
+            partial.found = true;
+          }
+          if (stats) partial.stats.add(total[v]);
+        }
+      }
+    }
+
+    // The static schedule hands out increasing ranges by rank.
+    uint32_t maxfreq = 0;
+    if (stats) *stats = CountStatistics();
+    for (auto &partial : partials) {
+      if (partial.found && partial.maxfreq >= maxfreq) {
+        maxfreq = partial.maxfreq;
+        *maxvtx = partial.argmax;
+      }
+      if (stats) *stats += partial.stats;
+    }
+    return maxfreq;
+  }
+
+  //! \brief Store the completed giant samples in their slots.
+  //!
+  //! \param begin The start of the range of the samples.
+  //! \param globalcnt The vertex counters to update, if any.
+  //! \param sink Called on each stored sample, if any.
+  void store_giant_samples(ItrTy begin, std::vector<uint32_t> *globalcnt,
+                           const typename worker_t::chunk_sink &sink = {}) {
+    for (auto &w : workers) {
+      for (auto &giant : w->giant_samples()) {
+        std::sort(giant.set.begin(), giant.set.end());
+        auto slot = begin;
+        std::advance(slot, giant.offset);
+        (*slot).assign(giant.set.begin(), giant.set.end());
+        if (globalcnt)
+          for (auto v : giant.set) (*globalcnt)[v] += 1;
+        if (sink) sink(slot, std::next(slot));
+      }
+      w->giant_samples().clear();
+    }
+  }
+
   size_t num_cpu_workers_, num_gpu_workers_;
   size_t max_batch_size_;
   std::shared_ptr<spdlog::logger> console;
@@ -954,7 +1337,18 @@ class StreamingRRRGenerator {
   std::unordered_map<size_t, std::shared_ptr<cuda_ctx<GraphTy>>> cuda_contexts_;
 #endif
   std::vector<worker_t *> workers;
-  std::atomic<size_t> mpmc_head{0};
+  WorkStealingScheduler scheduler_;
+  //! The alignment of the chunks: the batch of the batched CPU kernels or
+  //! the sets read from a live-edge world.
+  size_t granularity_;
+  size_t num_nodes_;
+  //! The state of the expansion of the giant samples.
+  std::vector<typename worker_t::GiantSample *> giants_;
+  std::vector<std::vector<vertex_t>> next_level_;
+  std::atomic<size_t> next_vertex_{0};
+  AtomicVisitedSet visited_;
+  //! The number of samples generated so far, the index of the next one.
+  size_t num_sampled_{0};
 
 #if CUDA_PROFILE
   struct iter_profile_t {
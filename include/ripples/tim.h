@@ -60,6 +60,7 @@
 #include "ripples/diffusion_simulation.h"
 #include "ripples/find_most_influential.h"
 #include "ripples/generate_rrr_sets.h"
+#include "ripples/sampling_scratch.h"
 #include "ripples/utility.h"
 
 #include "CLI/CLI.hpp"
@@ -120,39 +121,33 @@ size_t WR(GraphTy &G, typename GraphTy::vertex_type r, PRNG &generator,
 
   trng::uniform01_dist<float> value;
 
-  std::queue<vertex_type> queue;
-  std::vector<bool> visited(G.num_nodes(), false);
+  auto &scratch = thread_sampling_scratch<vertex_type>(G.num_nodes());
+  auto &queue = scratch.queue;
+  auto &visited = scratch.visited;
 
-  queue.push(r);
-  visited[r] = true;
+  queue.push_back(r);
+  visited.insert(r);
   size_t wr = 0;
 
   while (!queue.empty()) {
     vertex_type v = queue.front();
-    queue.pop();
+    queue.pop_front();
 
     wr += G.degree(v);
 
     if (std::is_same<diff_model_tag, ripples::independent_cascade_tag>::value) {
       for (auto u : G.neighbors(v)) {
         if (!visited[u.vertex] && value(generator) <= u.weight) {
-          queue.push(u.vertex);
-          visited[u.vertex] = true;
+          queue.push_back(u.vertex);
+          visited.insert(u.vertex);
         }
       }
     } else if (std::is_same<diff_model_tag,
                             ripples::linear_threshold_tag>::value) {
-      float threshold = value(generator);
-      for (auto u : G.neighbors(v)) {
-        threshold -= u.weight;
-
-        if (threshold > 0) continue;
-
-        if (!visited[u.vertex]) {
-          queue.push(u.vertex);
-          visited[u.vertex] = true;
-          break;
-        }
+      vertex_type u;
+      if (live_in_neighbor(G, v, generator, value, u) && !visited[u]) {
+        queue.push_back(u);
+        visited.insert(u);
       }
     } else {
       throw;
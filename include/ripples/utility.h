@@ -43,8 +43,14 @@
 #ifndef RIPPLES_UTILITY_H
 #define RIPPLES_UTILITY_H
 
+#include <algorithm>
 #include <chrono>
+#include <iterator>
+#include <numeric>
 #include <utility>
+#include <vector>
+
+#include <omp.h>
 
 #ifdef __APPLE__
 #include <libkern/OSByteOrder.h>
@@ -96,6 +102,149 @@ struct measure {
   }
 };
 
+//! \brief In-place inclusive prefix sum computed in parallel.
+//!
+//! Every thread scans a contiguous block, then the block totals are scanned
+//! and added back to the blocks.
+//!
+//! \tparam Itr The type of the random access iterators of the sequence.
+//!
+//! \param B The begin of the sequence.
+//! \param E The end of the sequence.
+template <typename Itr>
+void parallel_prefix_sum(Itr B, Itr E) {
+  using value_type = typename std::iterator_traits<Itr>::value_type;
+  size_t N = std::distance(B, E);
+  std::vector<value_type> partial;
+
+#pragma omp parallel
+  {
+    size_t num_threads = omp_get_num_threads();
+    size_t rank = omp_get_thread_num();
+#pragma omp single
+    partial.assign(num_threads + 1, value_type());
+
+    size_t low = N * rank / num_threads;
+    size_t high = N * (rank + 1) / num_threads;
+    std::partial_sum(B + low, B + high, B + low);
+    if (low < high) partial[rank + 1] = B[high - 1];
+
+#pragma omp barrier
+#pragma omp single
+    std::partial_sum(partial.begin(), partial.end(), partial.begin());
+
+    for (size_t i = low; i < high; ++i) B[i] += partial[rank];
+  }
+}
+
+//! \brief Stable sort of a sequence in parallel.
+//!
+//! Every thread sorts a block of the sequence, then the blocks are merged
+//! pairwise with std::inplace_merge in log(#threads) parallel rounds.  The
+//! result does not depend on the number of threads.
+//!
+//! \tparam Itr The type of the random access iterators of the sequence.
+//! \tparam Compare The type of the comparison function.
+//!
+//! \param B The begin of the sequence.
+//! \param E The end of the sequence.
+//! \param cmp The comparison function.
+template <typename Itr, typename Compare>
+void parallel_sort(Itr B, Itr E, Compare cmp) {
+  size_t N = std::distance(B, E);
+  std::vector<size_t> bounds;
+
+#pragma omp parallel
+  {
+    size_t num_threads = omp_get_num_threads();
+    size_t rank = omp_get_thread_num();
+#pragma omp single
+    {
+      bounds.resize(num_threads + 1);
+      for (size_t i = 0; i <= num_threads; ++i)
+        bounds[i] = N * i / num_threads;
+    }
+
+    std::stable_sort(B + bounds[rank], B + bounds[rank + 1], cmp);
+  }
+
+  size_t num_runs = bounds.size() - 1;
+  for (size_t stride = 1; stride < num_runs; stride *= 2) {
+#pragma omp parallel for
+    for (size_t i = 0; i < num_runs; i += 2 * stride) {
+      if (i + stride >= num_runs) continue;
+      size_t last = std::min(i + 2 * stride, num_runs);
+      std::inplace_merge(B + bounds[i], B + bounds[i + stride], B + bounds[last],
+                         cmp);
+    }
+  }
+}
+
+//! \brief Collect the distinct values of a sequence of elements in parallel.
+//!
+//! Every thread gathers the values of a block of the elements in chunks and
+//! folds each sorted, deduplicated chunk into its own run, so that the memory
+//! used is proportional to the number of distinct values and not to the
+//! number of elements.  The runs are then merged pairwise with std::set_union
+//! in log(#threads) parallel rounds.
+//!
+//! \tparam T The type of the values.
+//! \tparam ValuesFn The type of the function producing the values.
+//!
+//! \param N The number of elements.
+//! \param values Called as values(i, out), appends the values of the i-th
+//! element to the vector out.
+//! \return the distinct values, sorted.
+template <typename T, typename ValuesFn>
+std::vector<T> parallel_distinct_values(size_t N, ValuesFn &&values) {
+  constexpr size_t chunk_size = 1 << 20;
+  std::vector<std::vector<T>> runs;
+
+#pragma omp parallel
+  {
+    size_t num_threads = omp_get_num_threads();
+    size_t rank = omp_get_thread_num();
+#pragma omp single
+    runs.resize(num_threads);
+
+    size_t low = N * rank / num_threads;
+    size_t high = N * (rank + 1) / num_threads;
+    std::vector<T> chunk, merged;
+    std::vector<T> &run = runs[rank];
+    for (size_t i = low; i < high;) {
+      chunk.clear();
+      for (; i < high && chunk.size() < chunk_size; ++i) values(i, chunk);
+      std::sort(chunk.begin(), chunk.end());
+      chunk.erase(std::unique(chunk.begin(), chunk.end()), chunk.end());
+
+      merged.resize(run.size() + chunk.size());
+      merged.erase(std::set_union(run.begin(), run.end(), chunk.begin(),
+                                  chunk.end(), merged.begin()),
+                   merged.end());
+      run.swap(merged);
+    }
+  }
+
+  for (size_t stride = 1; stride < runs.size(); stride *= 2) {
+#pragma omp parallel for
+    for (size_t i = 0; i < runs.size(); i += 2 * stride) {
+      if (i + stride >= runs.size()) continue;
+      std::vector<T> &A = runs[i];
+      std::vector<T> &B = runs[i + stride];
+      std::vector<T> merged(A.size() + B.size());
+      merged.erase(
+          std::set_union(A.begin(), A.end(), B.begin(), B.end(), merged.begin()),
+          merged.end());
+      A.swap(merged);
+      std::vector<T>().swap(B);
+    }
+  }
+
+  if (runs.empty()) return std::vector<T>();
+  runs[0].shrink_to_fit();
+  return std::move(runs[0]);
+}
+
 }  // namespace ripples
 
 #ifndef __CUDACC__
@@ -0,0 +1,183 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_WEIGHTED_RRR_SETS_H
+#define RIPPLES_WEIGHTED_RRR_SETS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ripples {
+
+//! \brief An RRR set standing for multiplicity identical samples.
+//!
+//! \tparam RRRsetTy The type storing the vertices of the set.
+template <typename RRRsetTy>
+struct WeightedRRRset {
+  using value_type = typename RRRsetTy::value_type;
+
+  RRRsetTy vertices;
+  uint32_t multiplicity;
+
+  auto begin() const -> decltype(vertices.begin()) { return vertices.begin(); }
+  auto end() const -> decltype(vertices.end()) { return vertices.end(); }
+  size_t size() const { return vertices.size(); }
+  bool empty() const { return vertices.empty(); }
+  const value_type &operator[](size_t i) const { return vertices[i]; }
+};
+
+//! The number of samples an RRR set stands for when counting coverage.
+template <typename RRRsetTy>
+uint32_t rrr_set_multiplicity(const WeightedRRRset<RRRsetTy> &S) {
+  return S.multiplicity;
+}
+
+//! \brief Multiplicity-aware storage of Random Reverse Reachability sets.
+//!
+//! On low-probability graphs most samples are the singleton {root} or one of
+//! a few tiny sets.  Singletons are folded in a per-vertex histogram, and sets
+//! with up to max_dedup_size vertices are hash-deduplicated into (set,
+//! multiplicity) entries.  Larger sets are kept as entries of multiplicity one.
+//! Counting and seed selection weight every entry by its multiplicity, so
+//! their cost scales with the number of distinct sets instead of theta.
+//!
+//! \tparam RRRsetTy The type storing the vertices of the sets.
+template <typename RRRsetTy>
+class WeightedRRRsets {
+ public:
+  using vertex_type = typename RRRsetTy::value_type;
+  using value_type = WeightedRRRset<RRRsetTy>;
+
+  //! \param num_nodes The number of vertices of the sampled graph.
+  //! \param max_dedup_size The largest set that is deduplicated.
+  explicit WeightedRRRsets(size_t num_nodes, size_t max_dedup_size = 8)
+      : singletons_(num_nodes, 0),
+        max_dedup_size_(max_dedup_size),
+        num_sets_(0),
+        index_valid_(true) {}
+
+  //! Add one sorted RRR set.
+  template <typename Itr>
+  void insert(Itr B, Itr E) {
+    ++num_sets_;
+    size_t size = std::distance(B, E);
+    if (size == 0) return;
+    if (size == 1) {
+      singletons_[*B] += 1;
+      return;
+    }
+    if (size > max_dedup_size_) {
+      sets_.push_back(value_type{RRRsetTy(B, E), 1});
+      return;
+    }
+
+    if (!index_valid_) rebuild_index();
+    uint64_t h = hash(B, E);
+    auto range = index_.equal_range(h);
+    for (auto itr = range.first; itr != range.second; ++itr) {
+      auto &S = sets_[itr->second];
+      if (std::equal(S.begin(), S.end(), B, E)) {
+        S.multiplicity += 1;
+        return;
+      }
+    }
+    index_.emplace(h, sets_.size());
+    sets_.push_back(value_type{RRRsetTy(B, E), 1});
+  }
+
+  //! Add a sequence of sorted RRR sets.
+  template <typename SetItr>
+  void insert_sets(SetItr first, SetItr last) {
+    for (; first != last; ++first) insert(first->begin(), first->end());
+  }
+
+  //! The number of RRR sets stored, counting multiplicities.
+  size_t size() const { return num_sets_; }
+
+  //! The number of singleton RRR sets rooted at each vertex.
+  const std::vector<uint32_t> &singletons() const { return singletons_; }
+
+  //! \brief The distinct RRR sets with more than one vertex.
+  //!
+  //! The seed selection is free to reorder them.
+  std::vector<value_type> &sets() {
+    index_valid_ = false;
+    return sets_;
+  }
+  const std::vector<value_type> &sets() const { return sets_; }
+
+ private:
+  template <typename Itr>
+  static uint64_t hash(Itr B, Itr E) {
+    uint64_t h = 14695981039346656037ULL;
+    for (; B != E; ++B) {
+      h ^= static_cast<uint64_t>(*B);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  void rebuild_index() {
+    index_.clear();
+    for (size_t i = 0; i < sets_.size(); ++i) {
+      if (sets_[i].size() > max_dedup_size_) continue;
+      index_.emplace(hash(sets_[i].begin(), sets_[i].end()), i);
+    }
+    index_valid_ = true;
+  }
+
+  std::vector<uint32_t> singletons_;
+  std::vector<value_type> sets_;
+  std::unordered_multimap<uint64_t, size_t> index_;
+  size_t max_dedup_size_;
+  size_t num_sets_;
+  bool index_valid_;
+};
+
+}  // namespace ripples
+
+#endif  // RIPPLES_WEIGHTED_RRR_SETS_H
@@ -0,0 +1,192 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+//             Ripples: A C++ Library for Influence Maximization
+//                  Marco Minutoli <marco.minutoli@pnnl.gov>
+//                   Pacific Northwest National Laboratory
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2019, Battelle Memorial Institute
+//
+// Battelle Memorial Institute (hereinafter Battelle) hereby grants permission
+// to any person or entity lawfully obtaining a copy of this software and
+// associated documentation files (hereinafter “the Software”) to redistribute
+// and use the Software in source and binary forms, with or without
+// modification.  Such person or entity may use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and may permit
+// others to do so, subject to the following conditions:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimers.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Other than as used herein, neither the name Battelle Memorial Institute or
+//    Battelle may be used in any form whatsoever without the express written
+//    consent of Battelle.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL BATTELLE OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef RIPPLES_WORK_STEALING_H
+#define RIPPLES_WORK_STEALING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace ripples {
+
+//! \brief A range of work items owned by one worker.
+//!
+//! The bounds are packed in a single atomic word: the owner takes chunks from
+//! the front, thieves take half of what is left from the back.  Every range
+//! is padded to the size of a cache line, so that in an array of ranges the
+//! workers only contend with the thieves of their own range.  Padding rather
+//! than over-aligning keeps the array allocatable with plain new[] in C++14.
+class RangeDeque {
+ public:
+  RangeDeque() : range_(0) {}
+
+  //! Replace the content of the deque.
+  void reset(size_t first, size_t last) { range_.store(pack(first, last)); }
+
+  //! \brief Take a chunk from the front of the range.
+  //!
+  //! \param n The size of the chunk.
+  //! \param first The start of the chunk taken.
+  //! \param last The end of the chunk taken.
+  //! \return false if the range is empty.
+  bool pop_front(size_t n, size_t &first, size_t &last) {
+    uint64_t range = range_.load(std::memory_order_relaxed);
+    do {
+      first = front(range);
+      last = back(range);
+      if (first == last) return false;
+      last = std::min(last, first + n);
+    } while (!range_.compare_exchange_weak(range, pack(last, back(range))));
+    return true;
+  }
+
+  //! \brief Take the back half of the range.
+  //!
+  //! \param granularity The stolen range starts at a multiple of this.
+  //! \param first The start of the stolen range.
+  //! \param last The end of the stolen range.
+  //! \return false if the range is empty.
+  bool steal_back(size_t granularity, size_t &first, size_t &last) {
+    uint64_t range = range_.load(std::memory_order_relaxed);
+    do {
+      size_t b = front(range);
+      last = back(range);
+      if (b == last) return false;
+      first = b + (last - b) / 2;
+      first -= first % granularity;
+      first = std::max(first, b);
+    } while (!range_.compare_exchange_weak(range, pack(front(range), first)));
+    return true;
+  }
+
+ private:
+  static uint64_t pack(size_t first, size_t last) {
+    return (uint64_t(first) << 32) | uint64_t(last);
+  }
+  static size_t front(uint64_t range) { return range >> 32; }
+  static size_t back(uint64_t range) { return range & 0xFFFFFFFF; }
+
+  std::atomic<uint64_t> range_;
+  char padding_[64 - sizeof(std::atomic<uint64_t>)];
+};
+
+//! \brief Distribute a range of work items among workers with work stealing.
+//!
+//! The items are first split statically in one contiguous range per worker.
+//! A worker consumes its own range chunk by chunk and, once it is exhausted,
+//! steals half of the range of a random victim.  All the ranges handed out
+//! start at a multiple of the granularity, so batched kernels see the same
+//! batches whatever the schedule.
+class WorkStealingScheduler {
+ public:
+  //! \param num_workers The number of workers.
+  explicit WorkStealingScheduler(size_t num_workers)
+      : num_workers_(num_workers),
+        deques_(new RangeDeque[num_workers]),
+        granularity_(1) {}
+
+  //! \brief Prepare the distribution of a new range of work items.
+  //!
+  //! \param num_items The number of items, fewer than 2^32.
+  //! \param granularity The alignment of the ranges handed out.
+  void reset(size_t num_items, size_t granularity = 1) {
+    assert(num_items <= std::numeric_limits<uint32_t>::max());
+    granularity_ = granularity;
+    size_t num_blocks = (num_items + granularity - 1) / granularity;
+    for (size_t w = 0; w < num_workers_; ++w) {
+      size_t first = std::min(num_items,
+                              num_blocks * w / num_workers_ * granularity);
+      size_t last = std::min(num_items,
+                             num_blocks * (w + 1) / num_workers_ * granularity);
+      deques_[w].reset(first, last);
+    }
+  }
+
+  //! \brief The next chunk of work items of a worker.
+  //!
+  //! \param rank The rank of the worker.
+  //! \param chunk The preferred size of the chunk, a multiple of the
+  //! granularity.
+  //! \param first The start of the chunk.
+  //! \param last The end of the chunk.
+  //! \return false when no work is left.
+  bool next(size_t rank, size_t chunk, size_t &first, size_t &last) {
+    if (deques_[rank].pop_front(chunk, first, last)) return true;
+
+    // Random victims first, then a sweep to make sure everything is done.
+    uint64_t state = (uint64_t(rank) + 1) * 0x9E3779B97F4A7C15ull;
+    for (size_t attempt = 0; attempt < 3 * num_workers_; ++attempt) {
+      size_t victim;
+      if (attempt < 2 * num_workers_) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        victim = state % num_workers_;
+      } else {
+        victim = (rank + attempt) % num_workers_;
+      }
+      if (victim == rank) continue;
+
+      size_t stolen_first, stolen_last;
+      if (!deques_[victim].steal_back(granularity_, stolen_first,
+                                      stolen_last))
+        continue;
+      deques_[rank].reset(stolen_first, stolen_last);
+      if (deques_[rank].pop_front(chunk, first, last)) return true;
+    }
+    return false;
+  }
+
+ private:
+  size_t num_workers_;
+  std::unique_ptr<RangeDeque[]> deques_;
+  size_t granularity_;
+};
+
+}  // namespace ripples
+
+#endif /* RIPPLES_WORK_STEALING_H */
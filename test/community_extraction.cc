@@ -41,9 +41,19 @@
 //===----------------------------------------------------------------------===//
 
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include <unistd.h>
 
 #include "catch2/catch.hpp"
+#include "ripples/compressed_graph.h"
 #include "ripples/graph.h"
+#include "ripples/reordering.h"
+#include "ripples/soa_graph.h"
 
 using EdgeT = ripples::Edge<uint32_t, float>;
 std::vector<EdgeT> karate{
@@ -108,6 +118,325 @@ SCENARIO("Graph Build", "[graph build]") {
         }
       }
     }
+
+    WHEN("I build the Karate Graph keeping its vertex IDs") {
+      GraphFwd G(b, e, false);
+
+      THEN("G has one vertex per ID up to the largest one") {
+        REQUIRE(G.num_nodes() == 35);
+        REQUIRE(G.num_edges() == 78);
+        for (vertex_type v = 0; v < G.num_nodes(); ++v)
+          REQUIRE(G.convertID(v) == v);
+        for (const auto e : karate) {
+          auto n = G.neighbors(e.source);
+          REQUIRE(std::find(n.begin(), n.end(),
+                            typename GraphFwd::edge_type{e.destination,
+                                                         e.weight}) != n.end());
+        }
+      }
+    }
+
+    WHEN("I convert the weights of the graph to integer thresholds") {
+      using threshold_type = ripples::ThresholdDestination<uint32_t>;
+      GraphBwd G(b, e, true);
+      auto T = G.convert_edges<threshold_type>(
+          [](const destination_type &u) {
+            return threshold_type::FromWeighted(u);
+          });
+
+      THEN("Every edge keeps its place and gets the threshold of its weight") {
+        REQUIRE(T.num_nodes() == G.num_nodes());
+        REQUIRE(T.num_edges() == G.num_edges());
+        for (vertex_type v = 0; v < G.num_nodes(); ++v) {
+          REQUIRE(T.convertID(v) == G.convertID(v));
+          REQUIRE(T.degree(v) == G.degree(v));
+          auto t = T.neighbors(v).begin();
+          for (auto u : G.neighbors(v)) {
+            REQUIRE((*t).vertex == u.vertex);
+            REQUIRE((*t).threshold == threshold_type::ToThreshold(u.weight));
+            ++t;
+          }
+        }
+      }
+    }
+
+    WHEN("I collect the distinct IDs of more edges than fit in a chunk") {
+      size_t num_edges = 3 << 20;
+      auto source = [](size_t i) { return uint32_t(i * 2654435761u % 50021); };
+      auto destination = [](size_t i) { return uint32_t(i % 70001) * 3; };
+      auto ids = ripples::parallel_distinct_values<uint32_t>(
+          num_edges, [&](size_t i, std::vector<uint32_t> &out) {
+            out.push_back(source(i));
+            out.push_back(destination(i));
+          });
+
+      THEN("They are the sorted IDs without duplicates") {
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < num_edges; ++i) {
+          expected.push_back(source(i));
+          expected.push_back(destination(i));
+        }
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()),
+                       expected.end());
+        REQUIRE(ids == expected);
+      }
+    }
+  }
+}
+
+SCENARIO("Graph Binary Dump", "[graph binary]") {
+  GIVEN("The Karate Graph") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+    using vertex_type = typename GraphBwd::vertex_type;
+
+    GraphBwd G(karate.begin(), karate.end(), true);
+
+    char fileName[] = "/tmp/ripples-graph-XXXXXX";
+    int fd = mkstemp(fileName);
+    REQUIRE(fd != -1);
+    close(fd);
+    {
+      std::ofstream FS(fileName, std::ios::binary);
+      G.dump_binary(FS);
+    }
+
+    auto sameGraph = [&](const GraphBwd &R) {
+      REQUIRE(R.num_nodes() == G.num_nodes());
+      REQUIRE(R.num_edges() == G.num_edges());
+      for (vertex_type v = 0; v < G.num_nodes(); ++v) {
+        REQUIRE(R.convertID(v) == G.convertID(v));
+        REQUIRE(R.transformID(G.convertID(v)) == v);
+        auto n = G.neighbors(v);
+        auto m = R.neighbors(v);
+        REQUIRE(std::equal(n.begin(), n.end(), m.begin(), m.end()));
+      }
+    };
+
+    WHEN("I reload the dump from a stream") {
+      std::ifstream FS(fileName, std::ios::binary);
+      GraphBwd R(FS);
+      THEN("The reloaded graph is identical") { sameGraph(R); }
+    }
+
+    WHEN("I map the dump in memory") {
+      GraphBwd R = GraphBwd::map_binary(fileName);
+      THEN("The mapped graph is identical") { sameGraph(R); }
+      THEN("A copy of the mapped graph is identical") {
+        GraphBwd C(R);
+        sameGraph(C);
+      }
+    }
+
+    WHEN("I load the dump in a graph with the opposite direction") {
+      using GraphFwd = ripples::Graph<uint32_t, destination_type,
+                                      ripples::ForwardDirection<uint32_t>>;
+      GraphFwd Gf(karate.begin(), karate.end(), true);
+
+      THEN("The dump is transposed while loading") {
+        std::ifstream FS(fileName, std::ios::binary);
+        GraphFwd R(FS);
+        GraphFwd M = GraphFwd::map_binary(fileName);
+        for (vertex_type v = 0; v < Gf.num_nodes(); ++v) {
+          auto n = Gf.neighbors(v);
+          auto r = R.neighbors(v);
+          auto m = M.neighbors(v);
+          REQUIRE(std::equal(n.begin(), n.end(), r.begin(), r.end()));
+          REQUIRE(std::equal(n.begin(), n.end(), m.begin(), m.end()));
+        }
+      }
+    }
+
+    WHEN("I dump a graph carrying the linear threshold index") {
+      GraphBwd L(G);
+      L.build_lt_index();
+      {
+        std::ofstream FS(fileName, std::ios::binary);
+        L.dump_binary(FS);
+      }
+
+      auto sameIndex = [&](const GraphBwd &R) {
+        sameGraph(R);
+        REQUIRE(R.has_lt_index());
+        for (vertex_type v = 0; v < L.num_nodes(); ++v) {
+          float sum = 0;
+          for (size_t i = 0; i < L.degree(v); ++i) {
+            sum += L.neighbors(v).begin()[i].weight;
+            REQUIRE(L.lt_index(v)[i] == sum);
+            REQUIRE(R.lt_index(v)[i] == sum);
+          }
+        }
+      };
+
+      THEN("The index is restored from a stream") {
+        std::ifstream FS(fileName, std::ios::binary);
+        GraphBwd R(FS);
+        sameIndex(R);
+      }
+      THEN("The index is mapped in memory") {
+        sameIndex(GraphBwd::map_binary(fileName));
+      }
+    }
+
+    WHEN("I corrupt the layout or the index of the dump") {
+      std::fstream FS(fileName,
+                      std::ios::binary | std::ios::in | std::ios::out);
+      ripples::BinaryGraphHeader header;
+      FS.read(reinterpret_cast<char *>(&header), sizeof(header));
+      header.swap_little_endian();
+
+      auto rewrite = [&](ripples::BinaryGraphHeader H) {
+        H.swap_little_endian();
+        FS.seekp(0);
+        FS.write(reinterpret_cast<char *>(&H), sizeof(H));
+        FS.flush();
+      };
+      auto rejected = [&]() {
+        REQUIRE_THROWS_AS(GraphBwd::map_binary(fileName), std::runtime_error);
+        std::ifstream IS(fileName, std::ios::binary);
+        REQUIRE_THROWS_AS(GraphBwd(IS), std::runtime_error);
+      };
+
+      THEN("A misaligned section is rejected") {
+        auto H = header;
+        H.index_offset += sizeof(uint64_t);
+        rewrite(H);
+        rejected();
+      }
+      THEN("Overlapping sections are rejected") {
+        auto H = header;
+        H.edges_offset = H.index_offset;
+        rewrite(H);
+        rejected();
+      }
+      THEN("A section past the end of the dump is rejected") {
+        auto H = header;
+        H.num_edges = H.file_size;
+        rewrite(H);
+        rejected();
+      }
+      THEN("An index that does not end at the number of edges is rejected") {
+        uint64_t end = htole64(header.num_edges + 1);
+        FS.seekp(header.index_offset + header.num_nodes * sizeof(end));
+        FS.write(reinterpret_cast<char *>(&end), sizeof(end));
+        FS.flush();
+        rejected();
+      }
+    }
+
+    unlink(fileName);
+  }
+}
+
+SCENARIO("Compressed Graph", "[graph compression]") {
+  GIVEN("The Karate Graph") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+    using CompressedBwd =
+        ripples::CompressedGraph<uint32_t, float,
+                                 ripples::BackwardDirection<uint32_t>>;
+    using vertex_type = typename GraphBwd::vertex_type;
+
+    std::vector<EdgeT> edges(karate);
+    for (size_t i = 0; i < edges.size(); i += 3) edges[i].weight = 0.25;
+    GraphBwd G(edges.begin(), edges.end(), true);
+
+    WHEN("I compress the graph") {
+      CompressedBwd C(G);
+
+      THEN("The neighborhoods decode to the original ones") {
+        REQUIRE(C.num_nodes() == G.num_nodes());
+        REQUIRE(C.num_edges() == G.num_edges());
+        for (vertex_type v = 0; v < G.num_nodes(); ++v) {
+          REQUIRE(C.degree(v) == G.degree(v));
+          REQUIRE(C.convertID(v) == G.convertID(v));
+          auto n = G.neighbors(v);
+          auto m = C.neighbors(v);
+          REQUIRE(std::equal(n.begin(), n.end(), m.begin()));
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("Structure of Arrays Graph", "[graph soa]") {
+  GIVEN("The Karate Graph") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+    using vertex_type = typename GraphBwd::vertex_type;
+
+    GraphBwd G(karate.begin(), karate.end(), true);
+
+    WHEN("I store the weights as 8-bit probabilities") {
+      ripples::SoAGraph<uint32_t, ripples::fixed_point_weight<uint8_t>,
+                        ripples::BackwardDirection<uint32_t>>
+          S(G);
+
+      THEN("The neighborhoods are preserved up to the quantization step") {
+        REQUIRE(S.num_nodes() == G.num_nodes());
+        REQUIRE(S.num_edges() == G.num_edges());
+        for (vertex_type v = 0; v < G.num_nodes(); ++v) {
+          auto n = G.neighbors(v);
+          auto m = S.neighbors(v);
+          REQUIRE(std::equal(
+              n.begin(), n.end(), m.begin(),
+              [](const destination_type &a, const destination_type &b) {
+                return a.vertex == b.vertex &&
+                       std::abs(a.weight - b.weight) <= 1.0f / 255;
+              }));
+        }
+      }
+    }
+
+    WHEN("I store the weights as 32-bit probabilities") {
+      using codec = ripples::fixed_point_weight<uint32_t>;
+
+      THEN("The certain and impossible edges are preserved") {
+        REQUIRE(codec::encode(1.0f) == std::numeric_limits<uint32_t>::max());
+        REQUIRE(codec::decode(codec::encode(1.0f)) == 1.0f);
+        REQUIRE(codec::encode(0.0f) == 0);
+        REQUIRE(codec::decode(codec::encode(0.5f)) == 0.5f);
+      }
+    }
+  }
+}
+
+SCENARIO("Vertex Reordering", "[graph reordering]") {
+  GIVEN("The Karate Graph") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+    using vertex_type = typename GraphBwd::vertex_type;
+
+    GraphBwd G(karate.begin(), karate.end(), true);
+
+    for (std::string strategy : {"degree", "rcm", "gorder"}) {
+      WHEN("I reorder the vertices with " + strategy) {
+        GraphBwd R = ripples::reorder(G, strategy);
+
+        THEN("The edges are preserved in the original IDs") {
+          REQUIRE(R.num_nodes() == G.num_nodes());
+          REQUIRE(R.num_edges() == G.num_edges());
+          for (vertex_type v = 0; v < G.num_nodes(); ++v) {
+            vertex_type r = R.transformID(G.convertID(v));
+            REQUIRE(R.convertID(r) == G.convertID(v));
+            REQUIRE(R.degree(r) == G.degree(v));
+            for (auto u : G.neighbors(v)) {
+              auto n = R.neighbors(r);
+              auto itr = std::find(
+                  n.begin(), n.end(),
+                  destination_type{R.transformID(G.convertID(u.vertex)),
+                                   u.weight});
+              REQUIRE(itr != n.end());
+            }
+          }
+        }
+      }
+    }
   }
 }
 
@@ -40,11 +40,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <numeric>
+#include <set>
+#include <string>
+
 #include "catch2/catch.hpp"
 
+#include "ripples/compressed_graph.h"
 #include "ripples/generate_rrr_sets.h"
 #include "ripples/graph.h"
+#include "ripples/counter_rng.h"
 #include "ripples/imm.h"
+#include "ripples/live_edge_world.h"
+#include "ripples/rrr_sort.h"
+#include "ripples/soa_graph.h"
+#include "ripples/source_vertices.h"
 
 #include "trng/lcg64.hpp"
 
@@ -104,6 +114,427 @@ SCENARIO("Generate RRR sets", "[rrrsets]") {
       }
     }
 
+    WHEN("I count the RRR sets rooted at the sources instead of storing them") {
+      size_t theta = 2000;
+      std::vector<ripples::RRRset<GraphBwd>> RR(theta);
+      ripples::IMMExecutionRecord exRecord;
+
+      std::vector<trng::lcg64> generator(1);
+      ripples::GenerateRRRSets(G, generator, RR.begin(), RR.end(), exRecord,
+                               ripples::independent_cascade_tag{},
+                               ripples::sequential_tag{});
+
+      ripples::SourceVertices sources(G);
+      size_t absorbed = 0;
+      for (auto &set : RR) {
+        bool source = set.size() == 1 && G.degree(set[0]) == 0;
+        REQUIRE(sources.absorb(set) == source);
+        absorbed += source;
+      }
+
+      THEN("Exactly the singletons of the sources are counted.") {
+        REQUIRE(sources.num_sources() > 0);
+        REQUIRE(absorbed > 0);
+        const auto &counts = sources.counts();
+        REQUIRE(std::accumulate(counts.begin(), counts.end(), size_t(0)) ==
+                absorbed);
+        for (vertex_type v = 0; v < G.num_nodes(); ++v)
+          if (counts[v] != 0) REQUIRE(G.degree(v) == 0);
+      }
+
+      // The sets with the singletons of the sources dropped.
+      std::vector<ripples::RRRset<GraphBwd>> RRs(RR);
+      for (auto &set : RRs)
+        if (set.size() == 1 && G.degree(set[0]) == 0) set.clear();
+
+      // The selection kernels split the coverage among per-thread counters
+      // and only compare the local winners: on one thread they are exact, so
+      // the seeded and the stored counts must give the same choices.
+      size_t num_threads = omp_get_max_threads();
+      omp_set_num_threads(1);
+      size_t k = 8;
+      size_t n = G.num_nodes();
+
+      THEN("The bitmap selection picks the same seeds and coverage.") {
+        auto select = [&](std::vector<ripples::RRRset<GraphBwd>> &sets,
+                          std::vector<uint32_t> seeded) {
+          std::vector<size_t> n_ints(1, (theta + 31) / 32);
+          std::vector<std::vector<unsigned int *>> blockR(
+              1, std::vector<unsigned int *>(1));
+          blockR[0][0] = (unsigned int *)calloc((n + 1) * n_ints[0],
+                                                sizeof(unsigned int));
+          std::vector<bool *> deleteVtx(1, (bool *)calloc(n, sizeof(bool)));
+          for (size_t i = 0; i < theta; ++i)
+            ripples::encodeRR0(sets.begin() + i, i, sets[i].size(),
+                               n_ints[0], blockR[0][0]);
+          size_t local_m[1], local_v[1], maxk, maxv;
+          std::vector<size_t> seeds;
+          size_t covered = 0;
+          ripples::countRR0(blockR, n, n_ints, local_m, local_v, maxk, maxv,
+                            seeded.data());
+          while (seeds.size() < k && covered < theta) {
+            seeds.push_back(maxk);
+            covered += maxv;
+            seeded[maxk] = 0;
+            ripples::selectRR20(blockR, n, n_ints, local_m, local_v,
+                                deleteVtx, maxk, maxv, seeded.data());
+          }
+          free(blockR[0][0]);
+          free(deleteVtx[0]);
+          return std::make_pair(seeds, covered);
+        };
+        auto stored = select(RR, std::vector<uint32_t>(n));
+        auto seeded = select(RRs, sources.counts());
+        REQUIRE(stored.first == seeded.first);
+        REQUIRE(stored.second == seeded.second);
+      }
+
+      THEN("The Huffman selection picks the same seeds and coverage.") {
+        ripples::HuffmanTree *tree = ripples::createHuffmanTree(n);
+        ripples::initByRRRSets3<vertex_type>(tree, RR);
+        std::vector<uint32_t> frequencies(n);
+        for (auto &set : RR)
+          for (auto v : set) ++frequencies[v];
+        vertex_type first = std::max_element(frequencies.begin(),
+                                             frequencies.end()) -
+                            frequencies.begin();
+
+        auto select = [&](std::vector<ripples::RRRset<GraphBwd>> sets,
+                          std::vector<uint32_t> seeded) {
+          std::vector<unsigned char *> compR(theta);
+          std::vector<vertex_type *> copyR(theta);
+          std::vector<uint32_t> compBytes(theta), codeCnt(theta),
+              copyCnt(theta);
+          vertex_type maxvtx = tree->maxvtx;
+          for (size_t i = 0; i < theta; ++i)
+            ripples::encodeRRRSet3<vertex_type>(tree, sets.begin() + i, i,
+                                                compR, compBytes, codeCnt,
+                                                copyR, copyCnt, &maxvtx);
+          std::vector<bool> deleteflag(theta, false);
+          std::vector<vertex_type> seeds;
+          size_t covered = 0, freq = 0;
+          vertex_type seed = first;
+          while (seeds.size() < k && covered < theta) {
+            seeds.push_back(seed);
+            covered += seeded[seed];
+            seeded[seed] = 0;
+            seed = ripples::DecompAndFind4<vertex_type>(
+                tree, n, compR, codeCnt, copyR, copyCnt, deleteflag, theta,
+                seed, &freq, exRecord, ripples::omp_parallel_tag{}, 0,
+                seeded.data());
+            covered += freq;
+          }
+          for (size_t i = 0; i < theta; ++i) {
+            if (compBytes[i] != 0) free(compR[i]);
+            if (copyCnt[i] != 0) free(copyR[i]);
+          }
+          return std::make_pair(seeds, covered);
+        };
+        auto stored = select(RR, std::vector<uint32_t>(n));
+        auto seeded = select(RRs, sources.counts());
+        ripples::SZ_ReleaseHuffman(tree);
+        REQUIRE(stored.first == seeded.first);
+        REQUIRE(stored.second == seeded.second);
+      }
+
+      omp_set_num_threads(num_threads);
+    }
+
+    WHEN("I build the theta RRR sets on integer thresholds") {
+      using GraphThr =
+          ripples::Graph<uint32_t, ripples::ThresholdDestination<uint32_t>,
+                         ripples::BackwardDirection<uint32_t>>;
+      GraphThr Gt(karate.begin(), karate.end(), false);
+
+      size_t theta = 1000;
+      std::vector<ripples::RRRset<GraphThr>> RR(theta), RRf(theta);
+      ripples::IMMExecutionRecord exRecord;
+
+      std::vector<trng::lcg64> generator(1), generatorf(1);
+      ripples::GenerateRRRSets(Gt, generator, RR.begin(), RR.end(), exRecord,
+                               ripples::independent_cascade_tag{},
+                               ripples::sequential_tag{});
+      ripples::GenerateRRRSets(G, generatorf, RRf.begin(), RRf.end(),
+                               exRecord, ripples::independent_cascade_tag{},
+                               ripples::sequential_tag{});
+
+      THEN("They match the sets sampled with floating point weights.") {
+        double size = 0, sizef = 0;
+        for (size_t i = 0; i < theta; ++i) {
+          REQUIRE(!RR[i].empty());
+          size += RR[i].size();
+          sizef += RRf[i].size();
+        }
+        REQUIRE(size == Approx(sizef).epsilon(0.1));
+      }
+    }
+
+    WHEN("I build the theta LT RRR sets on the linear threshold index") {
+      GraphBwd Gi(G);
+      Gi.build_lt_index();
+
+      size_t theta = 100;
+      std::vector<ripples::RRRset<GraphBwd>> RR(theta), RRi(theta);
+      ripples::IMMExecutionRecord exRecord;
+
+      std::vector<trng::lcg64> generator(1), generatori(1);
+      ripples::GenerateRRRSets(G, generator, RR.begin(), RR.end(), exRecord,
+                               ripples::linear_threshold_tag{},
+                               ripples::sequential_tag{});
+      ripples::GenerateRRRSets(Gi, generatori, RRi.begin(), RRi.end(),
+                               exRecord, ripples::linear_threshold_tag{},
+                               ripples::sequential_tag{});
+
+      THEN("They are the sets sampled scanning the neighborhoods.") {
+        REQUIRE(RR == RRi);
+      }
+    }
+
+    WHEN("I build the theta RRR sets into an arena store") {
+      size_t theta = 100;
+      std::vector<ripples::RRRset<GraphBwd>> RR(theta);
+      ripples::RRRsetStore<GraphBwd> RRs;
+      RRs.extend(theta);
+      ripples::IMMExecutionRecord exRecord;
+
+      std::vector<trng::lcg64> generator(1), generators(1);
+      ripples::GenerateRRRSets(G, generator, RR.begin(), RR.end(), exRecord,
+                               ripples::independent_cascade_tag{},
+                               ripples::sequential_tag{});
+      ripples::GenerateRRRSets(G, generators, RRs.begin(), RRs.end(),
+                               exRecord, ripples::independent_cascade_tag{},
+                               ripples::sequential_tag{});
+
+      THEN("They are the sets stored in vectors.") {
+        REQUIRE(RRs.size() == theta);
+        for (size_t i = 0; i < theta; ++i) {
+          REQUIRE(std::equal(RR[i].begin(), RR[i].end(), RRs[i].begin(),
+                             RRs[i].end()));
+        }
+      }
+
+      THEN("Threads beyond omp_get_max_threads() can store them too.") {
+        ripples::RRRsetStore<GraphBwd> RRp;
+        RRp.extend(theta);
+        auto slots = RRp.begin();
+#pragma omp parallel num_threads(omp_get_max_threads() + 2)
+        {
+          size_t rank = omp_get_thread_num();
+          size_t num_threads = omp_get_num_threads();
+          for (size_t i = rank; i < theta; i += num_threads)
+            slots[i].assign(RR[i].begin(), RR[i].end());
+        }
+        ripples::RRRsetStore<GraphBwd> moved(std::move(RRp));
+        for (size_t i = 0; i < theta; ++i) {
+          REQUIRE(std::equal(RR[i].begin(), RR[i].end(), moved[i].begin(),
+                             moved[i].end()));
+        }
+      }
+
+      RRs.release();
+      THEN("Releasing the store empties its sets.") {
+        REQUIRE(RRs.size() == theta);
+        for (auto& e : RRs.sets()) REQUIRE(e.empty());
+      }
+    }
+
+    WHEN("I sample 64 at a time with a counter-based generator on 1 and 3 "
+         "workers") {
+      using ItrTy = typename std::vector<ripples::RRRset<GraphBwd>>::iterator;
+      using generator_type =
+          ripples::StreamingRRRGenerator<GraphBwd, ripples::Philox4x32, ItrTy,
+                                         ripples::independent_cascade_tag>;
+      size_t theta = 6400;
+      std::vector<ripples::RRRset<GraphBwd>> RR1(theta), RR3(theta);
+      ripples::IMMExecutionRecord exRecord;
+      std::unordered_map<size_t, size_t> worker_to_gpu;
+      ripples::Philox4x32 generator(42);
+
+      auto sample = [&](size_t workers, ItrTy begin, ItrTy end) {
+        generator_type se(G, generator, exRecord, workers, 0, worker_to_gpu,
+                          true);
+        se.generate(begin, end);
+        spdlog::drop("Streaming Generator");
+      };
+      sample(1, RR1.begin(), RR1.end());
+      sample(3, RR3.begin(), RR3.end());
+
+      THEN("They draw the same sorted RRR sets") {
+        for (size_t i = 0; i < theta; ++i) {
+          REQUIRE(!RR1[i].empty());
+          REQUIRE(std::is_sorted(RR1[i].begin(), RR1[i].end()));
+          REQUIRE(RR1[i] == RR3[i]);
+        }
+      }
+    }
+
+    WHEN("I walk the LT RRR sets in lockstep with a counter-based generator "
+         "on 1 and 3 workers") {
+      using ItrTy = typename std::vector<ripples::RRRset<GraphBwd>>::iterator;
+      using generator_type =
+          ripples::StreamingRRRGenerator<GraphBwd, ripples::Philox4x32, ItrTy,
+                                         ripples::linear_threshold_tag>;
+      size_t theta = 6400;
+      std::vector<ripples::RRRset<GraphBwd>> RR1(theta), RR3(theta);
+      ripples::IMMExecutionRecord exRecord;
+      std::unordered_map<size_t, size_t> worker_to_gpu;
+      ripples::Philox4x32 generator(42);
+
+      auto sample = [&](size_t workers, ItrTy begin, ItrTy end) {
+        generator_type se(G, generator, exRecord, workers, 0, worker_to_gpu,
+                          true);
+        se.generate(begin, end);
+        spdlog::drop("Streaming Generator");
+      };
+      sample(1, RR1.begin(), RR1.end());
+      sample(3, RR3.begin(), RR3.end());
+
+      THEN("They draw the same sorted RRR sets") {
+        for (size_t i = 0; i < theta; ++i) {
+          REQUIRE(!RR1[i].empty());
+          REQUIRE(std::is_sorted(RR1[i].begin(), RR1[i].end()));
+          REQUIRE(RR1[i] == RR3[i]);
+        }
+      }
+    }
+
+    WHEN("I sample with a counter-based generator on 1 and 3 workers") {
+      using ItrTy = typename std::vector<ripples::RRRset<GraphBwd>>::iterator;
+      using generator_type =
+          ripples::StreamingRRRGenerator<GraphBwd, ripples::Philox4x32, ItrTy,
+                                         ripples::independent_cascade_tag>;
+      size_t theta = 1000;
+      std::vector<ripples::RRRset<GraphBwd>> RR1(theta), RR3(theta);
+      ripples::IMMExecutionRecord exRecord;
+      std::unordered_map<size_t, size_t> worker_to_gpu;
+      ripples::Philox4x32 generator(42);
+
+      auto sample = [&](size_t workers, ItrTy begin, ItrTy end) {
+        generator_type se(G, generator, exRecord, workers, 0, worker_to_gpu);
+        auto middle = begin + std::distance(begin, end) / 3;
+        se.generate(begin, middle);
+        se.generate(middle, end);
+        spdlog::drop("Streaming Generator");
+      };
+      sample(1, RR1.begin(), RR1.end());
+      sample(3, RR3.begin(), RR3.end());
+
+      THEN("They draw the same RRR sets") {
+        for (size_t i = 0; i < theta; ++i) REQUIRE(RR1[i] == RR3[i]);
+      }
+    }
+
+    WHEN("I hand the RRR sets to a sink as soon as they are sampled") {
+      using StoreTy = ripples::RRRsetStore<GraphBwd>;
+      size_t theta = 2000;
+      StoreTy RRs;
+      RRs.extend(theta);
+      ripples::IMMExecutionRecord exRecord;
+      std::vector<std::vector<vertex_type>> sunk(theta);
+      std::vector<uint32_t> globalcnt(G.num_nodes());
+      vertex_type maxvtx = 0;
+
+      // The workers may outnumber the cores: each of them rewinds the arena
+      // the store created for its own thread.
+      std::unordered_map<size_t, size_t> worker_to_gpu;
+      ripples::StreamingRRRGenerator<GraphBwd, trng::lcg64, StoreTy::iterator,
+                                     ripples::independent_cascade_tag>
+          se(G, trng::lcg64(), exRecord, 3, 0, worker_to_gpu, false, 2);
+      se.generate2(RRs.begin(), RRs.end(), globalcnt, &maxvtx, nullptr,
+                   [&](StoreTy::iterator first, StoreTy::iterator last) {
+                     for (; first != last; ++first) {
+                       if ((*first).empty()) continue;
+                       sunk[first - RRs.begin()].assign((*first).begin(),
+                                                        (*first).end());
+                       (*first).clear();
+                     }
+                     RRs.rewind();
+                   });
+      spdlog::drop("Streaming Generator");
+
+      THEN("Every RRR set reaches the sink once and is counted.") {
+        std::vector<uint32_t> counts(G.num_nodes());
+        for (size_t i = 0; i < theta; ++i) {
+          REQUIRE(!sunk[i].empty());
+          REQUIRE(RRs[i].empty());
+          for (auto v : sunk[i]) ++counts[v];
+        }
+        REQUIRE(counts == globalcnt);
+        REQUIRE(counts[maxvtx] ==
+                *std::max_element(counts.begin(), counts.end()));
+      }
+    }
+
+    WHEN("I fold duplicate RRR sets") {
+      size_t theta = 1000;
+      std::vector<ripples::RRRset<GraphBwd>> RR(theta);
+      ripples::IMMExecutionRecord exRecord;
+
+      std::vector<trng::lcg64> generator(1);
+      ripples::GenerateRRRSets(G, generator, RR.begin(), RR.end(), exRecord,
+                               ripples::independent_cascade_tag{},
+                               ripples::sequential_tag{});
+
+      ripples::WeightedRRRsets<ripples::RRRset<GraphBwd>> WR(G.num_nodes());
+      WR.insert_sets(RR.begin(), RR.end());
+
+      THEN("The multiplicities add up to theta") {
+        size_t total = std::accumulate(WR.singletons().begin(),
+                                       WR.singletons().end(), size_t(0));
+        for (auto& e : WR.sets()) total += e.multiplicity;
+        REQUIRE(WR.size() == theta);
+        REQUIRE(total == theta);
+        REQUIRE(WR.sets().size() < theta);
+      }
+
+      THEN("The weighted selection picks the same seeds") {
+        ripples::IMMConfiguration CFG;
+        CFG.k = 4;
+        auto S = ripples::FindMostInfluentialSet(G, CFG, RR, exRecord, false,
+                                                 ripples::sequential_tag{});
+        auto SW = ripples::FindMostInfluentialSet(
+            G, CFG, WR, exRecord, false, ripples::sequential_tag{});
+        auto SP = ripples::FindMostInfluentialSet(
+            G, CFG, WR, exRecord, false, ripples::omp_parallel_tag{});
+        REQUIRE(S.second == SW.second);
+        REQUIRE(S.first == Approx(SW.first));
+        REQUIRE(SP.first == Approx(SW.first));
+      }
+
+      THEN("Folding them as they are sampled gives the same sets") {
+        ripples::IMMConfiguration CFG;
+        CFG.k = 4;
+        std::vector<trng::lcg64> generator(1), generatorw(1);
+        auto R = ripples::Sampling(G, CFG, 1, generator, exRecord,
+                                   ripples::independent_cascade_tag{},
+                                   ripples::sequential_tag{});
+        spdlog::drop("xc2:");
+        ripples::WeightedRRRsets<ripples::RRRset<GraphBwd>> folded(
+            G.num_nodes());
+        auto Rw = ripples::Sampling(G, CFG, 1, generatorw, exRecord,
+                                    ripples::independent_cascade_tag{},
+                                    ripples::sequential_tag{}, &folded);
+        spdlog::drop("xc2:");
+
+        ripples::WeightedRRRsets<ripples::RRRset<GraphBwd>> WRs(G.num_nodes());
+        WRs.insert_sets(R.sets().begin(), R.sets().end());
+        REQUIRE(Rw.empty());
+        REQUIRE(folded.size() == WRs.size());
+        REQUIRE(folded.singletons() == WRs.singletons());
+        // The selection of the theta estimation reorders the folded sets.
+        using entry = std::pair<std::vector<vertex_type>, uint32_t>;
+        std::set<entry> entries, entriesw;
+        for (auto& e : WRs.sets())
+          entries.emplace(std::vector<vertex_type>(e.begin(), e.end()),
+                          e.multiplicity);
+        for (auto& e : folded.sets())
+          entriesw.emplace(std::vector<vertex_type>(e.begin(), e.end()),
+                           e.multiplicity);
+        REQUIRE(folded.sets().size() == WRs.sets().size());
+        REQUIRE(entries == entriesw);
+      }
+    }
+
     WHEN("I build the theta RRR sets in parallel") {
       size_t theta = 100;
       std::vector<ripples::RRRset<GraphBwd>> RR(theta);
@@ -140,6 +571,554 @@ SCENARIO("Generate RRR sets", "[rrrsets]") {
 
         RR.insert(RR.end(), theta, ripples::RRRset<GraphBwd>{});
       }
+      spdlog::drop("Streaming Generator");
+    }
+  }
+}
+
+// A random graph whose edges are live with probability 0 or 1, so that the
+// RRR set of a root is the same whatever random numbers the sampler draws.
+// Most in-edges are dead and come in runs long enough for geometric skips.
+std::vector<EdgeT> certain_edges(uint32_t num_nodes) {
+  trng::lcg64 generator;
+  trng::uniform_int_dist vertex(0, num_nodes);
+  trng::uniform_int_dist coin(0, 6);
+  std::vector<EdgeT> edges;
+  for (uint32_t v = 0; v < num_nodes; ++v) {
+    edges.push_back({v, (v + 1) % num_nodes, 0});
+    for (uint32_t i = 0; i < 12; ++i)
+      edges.push_back({uint32_t(vertex(generator)), v,
+                       coin(generator) == 0 ? 1.f : 0.f});
+  }
+  return edges;
+}
+
+// A random graph where three vertices out of four have a single in-edge, of
+// weight 1: the LT walk from a root is the same whatever the thresholds.
+std::vector<EdgeT> certain_lt_edges(uint32_t num_nodes) {
+  trng::lcg64 generator;
+  trng::uniform_int_dist vertex(0, num_nodes);
+  std::vector<EdgeT> edges;
+  for (uint32_t v = 0; v < num_nodes; ++v)
+    if (v % 4 != 0) edges.push_back({uint32_t(vertex(generator)), v, 1});
+  return edges;
+}
+
+// The LT walk from the root along the single in-edges, up to a vertex
+// without in-edges or a vertex already visited.
+template <typename GraphTy>
+std::vector<typename GraphTy::vertex_type> certain_lt_rrr_set(
+    const GraphTy &G, typename GraphTy::vertex_type root) {
+  std::vector<typename GraphTy::vertex_type> result(1, root);
+  std::vector<char> reached(G.num_nodes());
+  reached[root] = 1;
+  for (auto v = root; G.degree(v) != 0;) {
+    v = (*G.neighbors(v).begin()).vertex;
+    if (reached[v]) break;
+    reached[v] = 1;
+    result.push_back(v);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// The vertices that reach the root through edges of probability 1.
+template <typename GraphTy>
+std::vector<typename GraphTy::vertex_type> certain_rrr_set(
+    const GraphTy &G, typename GraphTy::vertex_type root) {
+  std::vector<typename GraphTy::vertex_type> result(1, root);
+  std::vector<char> reached(G.num_nodes());
+  reached[root] = 1;
+  for (size_t i = 0; i < result.size(); ++i) {
+    for (auto u : G.neighbors(result[i])) {
+      if (u.weight != 1 || reached[u.vertex]) continue;
+      reached[u.vertex] = 1;
+      result.push_back(u.vertex);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// Sample on another layout H of a graph G of certain edges: the RRR set of
+// every root must be the one computed on G, and so must be the sets drawn by
+// GenerateRRRSets, for one of their vertices.
+template <typename GraphTy, typename LayoutTy, typename CertainFn,
+          typename diff_model_tag>
+void same_certain_rrr_sets(const GraphTy &G, const LayoutTy &H, size_t theta,
+                           CertainFn &&certain, diff_model_tag) {
+  using vertex_type = typename GraphTy::vertex_type;
+  std::vector<std::vector<vertex_type>> expected(G.num_nodes());
+  for (vertex_type v = 0; v < G.num_nodes(); ++v) expected[v] = certain(G, v);
+
+  trng::lcg64 generator;
+  for (size_t i = 0; i < theta; ++i) {
+    vertex_type root = i % G.num_nodes();
+    ripples::RRRset<LayoutTy> RR;
+    ripples::AddRRRSet(H, root, generator, RR, diff_model_tag{});
+    REQUIRE(std::equal(RR.begin(), RR.end(), expected[root].begin(),
+                       expected[root].end()));
+  }
+
+  std::vector<ripples::RRRset<LayoutTy>> RR(theta);
+  std::vector<trng::lcg64> generators(1);
+  ripples::IMMExecutionRecord exRecord;
+  ripples::GenerateRRRSets(H, generators, RR.begin(), RR.end(), exRecord,
+                           diff_model_tag{}, ripples::sequential_tag{});
+  for (auto &R : RR) {
+    std::vector<vertex_type> S(R.begin(), R.end());
+    REQUIRE(std::any_of(S.begin(), S.end(),
+                        [&](vertex_type v) { return expected[v] == S; }));
+  }
+}
+
+SCENARIO("Sample RRR sets on certain edges", "[rrrsets]") {
+  GIVEN("A random graph of edges that are either always or never live") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+    using vertex_type = typename GraphBwd::vertex_type;
+
+    auto edges = certain_edges(500);
+    GraphBwd G(edges.begin(), edges.end(), false);
+    G.build_ic_runs(2);
+    size_t theta = 2048;
+
+    WHEN("I build the RRR sets 64 at a time") {
+      std::vector<ripples::RRRset<GraphBwd>> RR(theta), RRb(theta);
+      trng::lcg64 generator, generatorb;
+      vertex_type roots[ripples::bit_parallel_batch_size];
+      for (size_t i = 0; i < theta; i += ripples::bit_parallel_batch_size) {
+        for (size_t j = 0; j < ripples::bit_parallel_batch_size; ++j) {
+          roots[j] = (i + j) % G.num_nodes();
+          ripples::AddRRRSet(G, roots[j], generator, RR[i + j],
+                             ripples::independent_cascade_tag{});
+        }
+        ripples::AddRRRSetBatch(G, roots, ripples::bit_parallel_batch_size,
+                                generatorb, RRb.begin() + i,
+                                ripples::independent_cascade_tag{});
+      }
+
+      THEN("Each set is the one of the scalar kernel") {
+        for (size_t i = 0; i < theta; ++i) {
+          auto expected = certain_rrr_set(G, i % G.num_nodes());
+          REQUIRE(std::equal(RR[i].begin(), RR[i].end(), expected.begin(),
+                             expected.end()));
+          REQUIRE(std::equal(RRb[i].begin(), RRb[i].end(), expected.begin(),
+                             expected.end()));
+        }
+      }
+    }
+
+    WHEN("I sample the RRR sets on the compressed graph") {
+      ripples::CompressedGraph<uint32_t, float,
+                               ripples::BackwardDirection<uint32_t>>
+          C(G);
+
+      THEN("They are the sets sampled on the graph") {
+        same_certain_rrr_sets(G, C, theta, certain_rrr_set<GraphBwd>,
+                              ripples::independent_cascade_tag{});
+      }
+    }
+
+    WHEN("I sample the RRR sets on the structure-of-arrays layouts") {
+      ripples::SoAGraph<uint32_t, ripples::fixed_point_weight<uint8_t>,
+                        ripples::BackwardDirection<uint32_t>>
+          S8(G);
+      ripples::SoAGraph<uint32_t, ripples::half_float_weight,
+                        ripples::BackwardDirection<uint32_t>>
+          Sh(G);
+
+      THEN("They are the sets sampled on the graph") {
+        same_certain_rrr_sets(G, S8, theta, certain_rrr_set<GraphBwd>,
+                              ripples::independent_cascade_tag{});
+        same_certain_rrr_sets(G, Sh, theta, certain_rrr_set<GraphBwd>,
+                              ripples::independent_cascade_tag{});
+      }
+    }
+
+    WHEN("I finish the RRR sets with large frontiers on all the workers") {
+      using ItrTy = typename std::vector<ripples::RRRset<GraphBwd>>::iterator;
+      std::vector<ripples::RRRset<GraphBwd>> RRg(theta);
+      ripples::IMMExecutionRecord exRecord;
+      std::unordered_map<size_t, size_t> worker_to_gpu;
+      ripples::StreamingRRRGenerator<GraphBwd, trng::lcg64, ItrTy,
+                                     ripples::independent_cascade_tag>
+          se(G, trng::lcg64(), exRecord, 3, 0, worker_to_gpu, false, 2);
+      se.generate(RRg.begin(), RRg.end());
+      spdlog::drop("Streaming Generator");
+
+      THEN("Each set is the certain RRR set of one of its vertices") {
+        std::vector<std::vector<vertex_type>> certain(G.num_nodes());
+        for (vertex_type v = 0; v < G.num_nodes(); ++v)
+          certain[v] = certain_rrr_set(G, v);
+        for (size_t i = 0; i < theta; ++i) {
+          std::vector<vertex_type> S(RRg[i].begin(), RRg[i].end());
+          REQUIRE(std::any_of(S.begin(), S.end(), [&](vertex_type v) {
+            return certain[v] == S;
+          }));
+        }
+      }
+    }
+
+    WHEN("I sample on the streaming workers with integer thresholds") {
+      using threshold_type = ripples::ThresholdDestination<uint32_t>;
+      auto T = G.convert_edges<threshold_type>(
+          [](const destination_type &u) {
+            return threshold_type::FromWeighted(u);
+          });
+      using GraphThr = decltype(T);
+      using ItrTy = typename std::vector<ripples::RRRset<GraphThr>>::iterator;
+      std::vector<ripples::RRRset<GraphThr>> RRt(theta);
+      ripples::IMMExecutionRecord exRecord;
+      std::unordered_map<size_t, size_t> worker_to_gpu;
+      ripples::StreamingRRRGenerator<GraphThr, trng::lcg64, ItrTy,
+                                     ripples::independent_cascade_tag>
+          se(T, trng::lcg64(), exRecord, 3, 0, worker_to_gpu);
+      se.generate(RRt.begin(), RRt.end());
+      spdlog::drop("Streaming Generator");
+
+      THEN("Each set is the certain RRR set of one of its vertices") {
+        std::vector<std::vector<vertex_type>> certain(G.num_nodes());
+        for (vertex_type v = 0; v < G.num_nodes(); ++v)
+          certain[v] = certain_rrr_set(G, v);
+        for (size_t i = 0; i < theta; ++i) {
+          std::vector<vertex_type> S(RRt[i].begin(), RRt[i].end());
+          REQUIRE(std::any_of(S.begin(), S.end(), [&](vertex_type v) {
+            return certain[v] == S;
+          }));
+        }
+      }
+    }
+
+    WHEN("I read many RRR sets from each live-edge world") {
+      using ItrTy = typename std::vector<ripples::RRRset<GraphBwd>>::iterator;
+      std::vector<ripples::RRRset<GraphBwd>> RRw(theta);
+      ripples::IMMExecutionRecord exRecord;
+      std::unordered_map<size_t, size_t> worker_to_gpu;
+      ripples::StreamingRRRGenerator<GraphBwd, trng::lcg64, ItrTy,
+                                     ripples::independent_cascade_tag>
+          se(G, trng::lcg64(), exRecord, 3, 0, worker_to_gpu, false, 0, 16);
+      se.generate(RRw.begin(), RRw.end());
+      spdlog::drop("Streaming Generator");
+
+      THEN("Each set is the certain RRR set of one of its vertices") {
+        std::vector<std::vector<vertex_type>> certain(G.num_nodes());
+        for (vertex_type v = 0; v < G.num_nodes(); ++v)
+          certain[v] = certain_rrr_set(G, v);
+        for (size_t i = 0; i < theta; ++i) {
+          std::vector<vertex_type> S(RRw[i].begin(), RRw[i].end());
+          REQUIRE(std::any_of(S.begin(), S.end(), [&](vertex_type v) {
+            return certain[v] == S;
+          }));
+        }
+      }
+    }
+  }
+
+  GIVEN("A random graph where every LT walk is fixed") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+    using vertex_type = typename GraphBwd::vertex_type;
+
+    auto edges = certain_lt_edges(2000);
+    GraphBwd G(edges.begin(), edges.end(), false);
+    size_t theta = 4096;
+
+    WHEN("I walk the LT RRR sets in lockstep") {
+      std::vector<ripples::RRRset<GraphBwd>> RR(theta), RRb(theta);
+      trng::lcg64 generator, generatorb;
+      vertex_type roots[ripples::bit_parallel_batch_size];
+      for (size_t i = 0; i < theta; i += ripples::bit_parallel_batch_size) {
+        for (size_t j = 0; j < ripples::bit_parallel_batch_size; ++j) {
+          roots[j] = (i + j) % G.num_nodes();
+          ripples::AddRRRSet(G, roots[j], generator, RR[i + j],
+                             ripples::linear_threshold_tag{});
+        }
+        ripples::AddRRRSetBatch(G, roots, ripples::bit_parallel_batch_size,
+                                generatorb, RRb.begin() + i,
+                                ripples::linear_threshold_tag{});
+      }
+
+      THEN("Each set is the one of the scalar kernel") {
+        for (size_t i = 0; i < theta; ++i) {
+          auto expected = certain_lt_rrr_set(G, i % G.num_nodes());
+          REQUIRE(std::equal(RR[i].begin(), RR[i].end(), expected.begin(),
+                             expected.end()));
+          REQUIRE(std::equal(RRb[i].begin(), RRb[i].end(), expected.begin(),
+                             expected.end()));
+        }
+      }
+    }
+
+    WHEN("I walk the LT RRR sets on the compressed graph") {
+      ripples::CompressedGraph<uint32_t, float,
+                               ripples::BackwardDirection<uint32_t>>
+          C(G);
+
+      THEN("They are the walks on the graph") {
+        same_certain_rrr_sets(G, C, theta, certain_lt_rrr_set<GraphBwd>,
+                              ripples::linear_threshold_tag{});
+      }
+    }
+
+    WHEN("I walk the LT RRR sets on the structure-of-arrays layouts") {
+      ripples::SoAGraph<uint32_t, ripples::fixed_point_weight<uint8_t>,
+                        ripples::BackwardDirection<uint32_t>>
+          S8(G);
+      ripples::SoAGraph<uint32_t, ripples::half_float_weight,
+                        ripples::BackwardDirection<uint32_t>>
+          Sh(G);
+
+      THEN("They are the walks on the graph") {
+        same_certain_rrr_sets(G, S8, theta, certain_lt_rrr_set<GraphBwd>,
+                              ripples::linear_threshold_tag{});
+        same_certain_rrr_sets(G, Sh, theta, certain_lt_rrr_set<GraphBwd>,
+                              ripples::linear_threshold_tag{});
+      }
+    }
+  }
+}
+
+// A random graph whose in-edge weights are not dyadic fractions, normalized
+// so that each neighborhood sums to at most 1 as the LT model requires.
+std::vector<EdgeT> random_lt_edges(uint32_t num_nodes) {
+  trng::lcg64 generator;
+  trng::uniform_int_dist vertex(0, num_nodes);
+  trng::uniform_int_dist degree(1, 20);
+  trng::uniform01_dist<float> value;
+  std::vector<EdgeT> edges;
+  for (uint32_t v = 0; v < num_nodes; ++v) {
+    size_t first = edges.size();
+    float sum = 0;
+    for (long i = degree(generator); i > 0; --i) {
+      float w = 0.1f + value(generator);
+      edges.push_back({uint32_t(vertex(generator)), v, w});
+      sum += w;
+    }
+    float scale = (0.5f + value(generator) / 2) / sum;
+    for (size_t i = first; i < edges.size(); ++i) edges[i].weight *= scale;
+  }
+  return edges;
+}
+
+SCENARIO("Linear threshold index", "[rrrsets]") {
+  GIVEN("A random graph with non-dyadic LT weights") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+
+    auto edges = random_lt_edges(2000);
+    GraphBwd G(edges.begin(), edges.end(), false);
+    GraphBwd Gi(G);
+    Gi.build_lt_index();
+
+    WHEN("I sample the same RRR sets with and without the index") {
+      size_t theta = 20000;
+      size_t mismatches = 0;
+      for (size_t i = 0; i < theta; ++i) {
+        ripples::RRRset<GraphBwd> RR, RRi;
+        trng::lcg64 generator, generatori;
+        generator.seed(i);
+        generatori.seed(i);
+        ripples::AddRRRSet(G, i % G.num_nodes(), generator, RR,
+                           ripples::linear_threshold_tag{});
+        ripples::AddRRRSet(Gi, i % G.num_nodes(), generatori, RRi,
+                           ripples::linear_threshold_tag{});
+        if (!(RR == RRi)) ++mismatches;
+      }
+
+      THEN("They differ only where float rounding picks another edge") {
+        REQUIRE(mismatches <= theta / 1000);
+      }
+    }
+  }
+}
+
+SCENARIO("Live-edge worlds", "[rrrsets]") {
+  GIVEN("A world with the components {0, 1, 2}, {3, 4} and singletons") {
+    // The live in-neighbors of each vertex: 0 -> 1 -> 2 -> 0 and 3 <-> 4 are
+    // cycles, 5 reaches the first cycle and 6, the first cycle and 6 reach
+    // the second one, and 4 reaches 7.  Vertex 8 is isolated.
+    std::vector<std::vector<uint32_t>> live_in = {
+        {2, 5}, {0}, {1}, {2, 4, 6}, {3}, {}, {5}, {4}, {}};
+    ripples::LiveEdgeWorld<uint32_t> world;
+    world.build(live_in.size(), [&](uint32_t v, auto &&add) {
+      for (auto u : live_in[v]) add(u);
+    });
+
+    THEN("It has one component per cycle and per other vertex") {
+      REQUIRE(world.num_components() == 6);
+    }
+
+    THEN("The RRR set of a root is the set of the vertices reaching it") {
+      std::vector<std::vector<uint32_t>> expected = {
+          {0, 1, 2, 5},          {0, 1, 2, 5},
+          {0, 1, 2, 5},          {0, 1, 2, 3, 4, 5, 6},
+          {0, 1, 2, 3, 4, 5, 6}, {5},
+          {5, 6},                {0, 1, 2, 3, 4, 5, 6, 7},
+          {8}};
+      std::vector<uint32_t> result;
+      for (uint32_t v = 0; v < live_in.size(); ++v) {
+        world.rrr_set(v, result);
+        REQUIRE(result == expected[v]);
+      }
+    }
+
+    WHEN("I rebuild it as a single cycle") {
+      world.build(live_in.size(), [&](uint32_t v, auto &&add) {
+        add((v + 1) % live_in.size());
+      });
+
+      THEN("Every RRR set is the whole world") {
+        REQUIRE(world.num_components() == 1);
+        std::vector<uint32_t> result, all(live_in.size());
+        std::iota(all.begin(), all.end(), 0);
+        for (uint32_t v = 0; v < live_in.size(); ++v) {
+          world.rrr_set(v, result);
+          REQUIRE(result == all);
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("Geometric skip sampling", "[rrrsets]") {
+  GIVEN("A star of unlikely in-edges") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+
+    const uint32_t leaves = 1000;
+    const float p = 0.05;
+    std::vector<EdgeT> star;
+    for (uint32_t i = 1; i <= leaves; ++i) star.push_back({i, 0, p});
+    GraphBwd G(star.begin(), star.end(), false);
+    G.build_ic_runs();
+
+    WHEN("I index the equal-weight runs") {
+      THEN("The in-edges of the center are a single run") {
+        auto runs = G.ic_runs(0);
+        REQUIRE(runs.second - runs.first == 1);
+        REQUIRE(runs.first->begin == 0);
+        REQUIRE(runs.first->end == leaves);
+        for (uint32_t v = 1; v <= leaves; ++v)
+          REQUIRE(G.ic_runs(v).first == G.ic_runs(v).second);
+      }
+    }
+
+    WHEN("I sample the RRR sets rooted at the center") {
+      size_t theta = 2000;
+      trng::lcg64 generator;
+      double size = 0;
+      for (size_t i = 0; i < theta; ++i) {
+        ripples::RRRset<GraphBwd> R;
+        ripples::AddRRRSet(G, 0, generator, R,
+                           ripples::independent_cascade_tag{});
+        REQUIRE(std::adjacent_find(R.begin(), R.end()) == R.end());
+        size += R.size();
+      }
+
+      THEN("Their average size matches the expected number of live edges") {
+        REQUIRE(size / theta == Approx(1 + leaves * p).epsilon(0.02));
+      }
+    }
+  }
+  GIVEN("A neighborhood with runs of different weights") {
+    using destination_type = ripples::WeightedDestination<uint32_t, float>;
+    using GraphBwd = ripples::Graph<uint32_t, destination_type,
+                                    ripples::BackwardDirection<uint32_t>>;
+
+    std::vector<EdgeT> edges;
+    uint32_t source = 1;
+    for (auto run : {std::make_pair(10, 0.1f), std::make_pair(3, 0.2f),
+                     std::make_pair(9, 0.3f)})
+      for (int i = 0; i < run.first; ++i)
+        edges.push_back({source++, 0, run.second});
+    GraphBwd G(edges.begin(), edges.end(), false);
+
+    WHEN("I index the runs of at least 8 edges") {
+      G.build_ic_runs();
+
+      THEN("The short run in between is left out") {
+        auto runs = G.ic_runs(0);
+        REQUIRE(runs.second - runs.first == 2);
+        REQUIRE(runs.first[0].begin == 0);
+        REQUIRE(runs.first[0].end == 10);
+        REQUIRE(runs.first[1].begin == 13);
+        REQUIRE(runs.first[1].end == 22);
+      }
+    }
+  }
+}
+
+SCENARIO("Small RRR sets", "[rrrsets]") {
+  GIVEN("An RRR set with inline storage") {
+    using RRRset = ripples::SmallRRRset<uint32_t, std::allocator<uint32_t>, 4>;
+    RRRset A;
+    for (uint32_t v = 0; v < 3; ++v) A.push_back(v);
+
+    THEN("Small sets stay inline") {
+      REQUIRE(A.is_inline());
+      REQUIRE(A.size() == 3);
+      REQUIRE(A.back() == 2);
+    }
+
+    WHEN("It grows past the inline capacity") {
+      RRRset B(A);
+      for (uint32_t v = 3; v < 100; ++v) B.push_back(v);
+
+      THEN("It spills to the heap and keeps its vertices") {
+        REQUIRE(!B.is_inline());
+        REQUIRE(B.size() == 100);
+        for (uint32_t v = 0; v < 100; ++v) REQUIRE(B[v] == v);
+      }
+
+      THEN("Swapping with an inline set exchanges the contents") {
+        RRRset C(A), D(B);
+        swap(C, D);
+        REQUIRE(C == B);
+        REQUIRE(D == A);
+        REQUIRE(D.is_inline());
+      }
+
+      THEN("Shrinking a small set moves it back inline") {
+        B.resize(2);
+        B.shrink_to_fit();
+        REQUIRE(B.is_inline());
+        REQUIRE(B.size() == 2);
+        REQUIRE(B[1] == 1);
+      }
+    }
+  }
+}
+
+SCENARIO("Sorted RRR set emission", "[rrrsets]") {
+  GIVEN("Shuffled sets of distinct vertices of every shape") {
+    trng::lcg64 generator;
+    trng::uniform_int_dist vertex(0, 1 << 24);
+    std::vector<uint32_t> buffer;
+
+    for (size_t size : {2, 20, 200, 2000}) {
+      for (uint32_t span : {size_t(1) << 24, 2 * size}) {
+        std::set<uint32_t> members;
+        while (members.size() < size) members.insert(vertex(generator) % span);
+        std::vector<uint32_t> set(members.begin(), members.end());
+        std::reverse(set.begin(), set.end());
+        std::swap(set.front(), set[set.size() / 2]);
+
+        WHEN("I sort a set of " + std::to_string(size) + " vertices over " +
+             std::to_string(span) + " IDs") {
+          ripples::SortRRRSet(set.begin(), set.end(), buffer,
+                              [&](uint32_t v) { return members.count(v); });
+
+          THEN("It holds its vertices in increasing order") {
+            REQUIRE(std::equal(set.begin(), set.end(), members.begin(),
+                               members.end()));
+          }
+        }
+      }
     }
   }
 }
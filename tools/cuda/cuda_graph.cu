@@ -55,13 +55,13 @@ __global__ void build_graph_kernel(
                                    typename cuda_device_graph<GraphTy>::weight_t *d_weights,
                                    typename cuda_device_graph<GraphTy>::vertex_t *d_index,
                                    typename GraphTy::edge_type *d_src_weighted_edges,
-                                   typename GraphTy::edge_type **d_src_index, size_t num_nodes) {
+                                   const typename GraphTy::index_type *d_src_index, size_t num_nodes) {
   using vertex_t = typename cuda_device_graph<GraphTy>::vertex_t;
 
   int tid = blockIdx.x * blockDim.x + threadIdx.x;
   if (tid < num_nodes) {
-    vertex_t first = d_src_index[tid] - d_src_index[0];
-    vertex_t last = d_src_index[tid + 1] - d_src_index[0];
+    vertex_t first = d_src_index[tid];
+    vertex_t last = d_src_index[tid + 1];
     if(tid == 0)
       d_index[0] = 0;
     d_index[tid + 1] = last;
@@ -95,10 +95,11 @@ cuda_device_graph<GraphTy> *make_cuda_graph(const GraphTy &hg){
   cudaMalloc(&d_weighted_edges, hg.num_edges() * sizeof(destination_type));
   cudaMemcpy(d_weighted_edges, hg.csr_edges(),
              hg.num_edges() * sizeof(destination_type), cudaMemcpyHostToDevice);
-  destination_type **d_index;
-  cudaMalloc(&d_index, (hg.num_nodes() + 1) * sizeof(destination_type *));
+  using index_type = typename GraphTy::index_type;
+  index_type *d_index;
+  cudaMalloc(&d_index, (hg.num_nodes() + 1) * sizeof(index_type));
   cudaMemcpy(d_index, hg.csr_index(),
-             (hg.num_nodes() + 1) * sizeof(destination_type *),
+             (hg.num_nodes() + 1) * sizeof(index_type),
              cudaMemcpyHostToDevice);
   cuda_check(__FILE__, __LINE__);
 
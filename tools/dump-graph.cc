@@ -57,6 +57,7 @@
 struct DumpOutputConfiguration {
   std::string OName{"output"};
   bool binaryDump{false};
+  bool backward{false};
   bool normalize{false};
 
   void addCmdOptions(CLI::App &app) {
@@ -66,6 +67,9 @@ struct DumpOutputConfiguration {
     app.add_flag("--dump-binary", binaryDump,
                  "Dump the Graph in binary format.")
         ->group("Output Options");
+    app.add_flag("--backward", backward,
+                 "Dump the transposed Graph used for sampling (binary only).")
+        ->group("Output Options");
     app.add_flag("--normalize", normalize,
                  "Dump the Graph in text format with vertices starting from 1")
         ->group("Output Options");
@@ -97,7 +101,26 @@ int main(int argc, char **argv) {
   spdlog::set_level(spdlog::level::info);
 
   using Graph = ripples::Graph<uint32_t>;
+  using GraphBwd =
+      ripples::Graph<uint32_t, ripples::WeightedDestination<uint32_t, float>,
+                     ripples::BackwardDirection<uint32_t>>;
   auto console = spdlog::stdout_color_st("console");
+
+  if (CFG.binaryDump && CFG.backward) {
+    // imm maps a backward dump in place, without transposing it.  Under LT
+    // the dump also carries the index used to pick live in-edges.
+    console->info("Loading...");
+    GraphBwd G = ripples::loadGraph<GraphBwd>(CFG, weightGen);
+    console->info("Loading Done!");
+    console->info("Number of Nodes : {}", G.num_nodes());
+    console->info("Number of Edges : {}", G.num_edges());
+
+    auto file = std::fstream(CFG.OName, std::ios::out | std::ios::binary);
+    G.dump_binary(file);
+    file.close();
+    return EXIT_SUCCESS;
+  }
+
   console->info("Loading...");
   Graph G = ripples::loadGraph<Graph>(CFG, weightGen);
   console->info("Loading Done!");
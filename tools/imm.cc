@@ -45,6 +45,7 @@
 #include <string>
 
 #include "ripples/configuration.h"
+#include "ripples/counter_rng.h"
 #include "ripples/diffusion_simulation.h"
 #include "ripples/graph.h"
 #include "ripples/imm.h"
@@ -130,44 +131,16 @@ void parse_command_line(int argc, char **argv) {
 
 ToolConfiguration<ripples::IMMConfiguration> configuration() { return CFG; }
 
-}  // namespace ripples
-
-int main(int argc, char **argv) {
-  auto console = spdlog::stdout_color_st("console");
-
-  // process command line
-  ripples::parse_command_line(argc, argv);
-  auto CFG = ripples::configuration();
-  if (CFG.parallel) {
-    if (ripples::streaming_command_line(
-            CFG.worker_to_gpu, CFG.streaming_workers, CFG.streaming_gpu_workers,
-            CFG.gpu_mapping_string) != 0) {
-      console->error("invalid command line");
-      return -1;
-    }
-  }
-
-  spdlog::set_level(spdlog::level::info);
-
-  trng::lcg64 weightGen;
-  weightGen.seed(0UL);
-  weightGen.split(2, 0);
-
-  using dest_type = ripples::WeightedDestination<uint32_t, float>;
-  using GraphFwd =
-      ripples::Graph<uint32_t, dest_type, ripples::ForwardDirection<uint32_t>>;
-  using GraphBwd =
-      ripples::Graph<uint32_t, dest_type, ripples::BackwardDirection<uint32_t>>;
-  console->info("Loading...");
-  GraphFwd Gf = ripples::loadGraph<GraphFwd>(CFG, weightGen);
-  GraphBwd G = Gf.get_transpose();
-  console->info("Loading Done!");
-  console->info("Number of Nodes : {}", G.num_nodes());
-  console->info("Number of Edges : {}", G.num_edges());
-
+//! Run IMM on the loaded graph and write the experiment record.
+//!
+//! \param G The backward graph.
+//! \param CFG The configuration of the tool.
+template <typename GraphTy>
+void run_imm(GraphTy &G, const ToolConfiguration<IMMConfiguration> &CFG) {
+  auto console = spdlog::get("console");
   nlohmann::json executionLog;
 
-  std::vector<typename GraphBwd::vertex_type> seeds;
+  std::vector<typename GraphTy::vertex_type> seeds;
   ripples::IMMExecutionRecord R;
 
   trng::lcg64 generator;
@@ -180,32 +153,40 @@ int main(int argc, char **argv) {
     auto workers = CFG.streaming_workers;
     auto gpu_workers = CFG.streaming_gpu_workers;
     decltype(R.Total) real_total;
-    if (CFG.diffusionModel == "IC") {
+    // Run IMM on the streaming engine with a given generator and model.
+    auto streaming_imm = [&](const auto &master_rng, auto model_tag,
+                             bool batched_walks) {
+      using model_type = decltype(model_tag);
       ripples::StreamingRRRGenerator<
-          decltype(G), decltype(generator),
-          typename ripples::RRRsets<decltype(G)>::iterator,
-          ripples::independent_cascade_tag>
-          se(G, generator, R, workers - gpu_workers, gpu_workers,
-             CFG.worker_to_gpu);
+          GraphTy, std::decay_t<decltype(master_rng)>,
+          typename ripples::RRRsetStore<GraphTy>::iterator, model_type>
+          se(G, master_rng, R, workers - gpu_workers, gpu_workers,
+             CFG.worker_to_gpu, batched_walks, CFG.giant_rrr_frontier,
+             CFG.rrr_sets_per_world);
       auto start = std::chrono::high_resolution_clock::now();
-      seeds = IMM3(G, CFG, 1, se, ripples::independent_cascade_tag{},
-                  ripples::omp_parallel_tag{});
+      seeds = IMM3(G, CFG, 1, se, model_type{}, ripples::omp_parallel_tag{});
       auto end = std::chrono::high_resolution_clock::now();
       R.Total = end - start - R.Total;
       real_total = end - start;
+    };
+
+#ifndef RIPPLES_ENABLE_CUDA
+    ripples::Philox4x32 counter_generator(0UL);
+    if (CFG.counter_rng) {
+      if (CFG.diffusionModel == "IC")
+        streaming_imm(counter_generator, ripples::independent_cascade_tag{},
+                      CFG.bit_parallel_walks);
+      else if (CFG.diffusionModel == "LT")
+        streaming_imm(counter_generator, ripples::linear_threshold_tag{},
+                      CFG.interleaved_lt_walks);
+    } else
+#endif
+    if (CFG.diffusionModel == "IC") {
+      streaming_imm(generator, ripples::independent_cascade_tag{},
+                    CFG.bit_parallel_walks);
     } else if (CFG.diffusionModel == "LT") {
-      ripples::StreamingRRRGenerator<
-          decltype(G), decltype(generator),
-          typename ripples::RRRsets<decltype(G)>::iterator,
-          ripples::linear_threshold_tag>
-          se(G, generator, R, workers - gpu_workers, gpu_workers,
-             CFG.worker_to_gpu);
-      auto start = std::chrono::high_resolution_clock::now();
-      seeds = IMM3(G, CFG, 1, se, ripples::linear_threshold_tag{},
-                  ripples::omp_parallel_tag{});
-      auto end = std::chrono::high_resolution_clock::now();
-      R.Total = end - start - R.Total;
-      real_total = end - start;
+      streaming_imm(generator, ripples::linear_threshold_tag{},
+                    CFG.interleaved_lt_walks);
     }
 
     console->info("IMM Parallel : {}ms", R.Total.count());
@@ -246,6 +227,60 @@ int main(int argc, char **argv) {
     executionLog.push_back(experiment);
     perf << executionLog.dump(2);
   }
+}
+
+}  // namespace ripples
+
+int main(int argc, char **argv) {
+  auto console = spdlog::stdout_color_st("console");
+
+  // process command line
+  ripples::parse_command_line(argc, argv);
+  auto CFG = ripples::configuration();
+  if (CFG.parallel) {
+    if (ripples::streaming_command_line(
+            CFG.worker_to_gpu, CFG.streaming_workers, CFG.streaming_gpu_workers,
+            CFG.gpu_mapping_string) != 0) {
+      console->error("invalid command line");
+      return -1;
+    }
+  }
+  if (CFG.parallel && CFG.dedup_rrr_sets) {
+    console->error("--dedup-rrr-sets is not supported by the streaming engine");
+    return -1;
+  }
+#ifdef RIPPLES_ENABLE_CUDA
+  if (CFG.counter_rng) {
+    console->error("--counter-rng is not supported by the GPU walk workers");
+    return -1;
+  }
+#endif
+
+  spdlog::set_level(spdlog::level::info);
+
+  trng::lcg64 weightGen;
+  weightGen.seed(0UL);
+  weightGen.split(2, 0);
+
+  using dest_type = ripples::WeightedDestination<uint32_t, float>;
+  using GraphBwd =
+      ripples::Graph<uint32_t, dest_type, ripples::BackwardDirection<uint32_t>>;
+  console->info("Loading...");
+  GraphBwd G = ripples::loadGraph<GraphBwd>(CFG, weightGen);
+  console->info("Loading Done!");
+  console->info("Number of Nodes : {}", G.num_nodes());
+  console->info("Number of Edges : {}", G.num_edges());
+
+  if (CFG.integer_thresholds) {
+    using threshold_type = ripples::ThresholdDestination<uint32_t>;
+    auto T = G.convert_edges<threshold_type>(
+        [](const dest_type &u) { return threshold_type::FromWeighted(u); });
+    G = GraphBwd();
+    if (CFG.diffusionModel == "IC") T.build_ic_runs();
+    ripples::run_imm(T, CFG);
+  } else {
+    ripples::run_imm(G, CFG);
+  }
 
   return EXIT_SUCCESS;
 }
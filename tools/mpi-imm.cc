@@ -134,13 +134,10 @@ int main(int argc, char *argv[]) {
   weightGen.split(2, 0);
 
   using edge_type = ripples::WeightedDestination<uint32_t, float>;
-  using GraphFwd =
-      ripples::Graph<uint32_t, edge_type, ripples::ForwardDirection<uint32_t>>;
   using GraphBwd =
       ripples::Graph<uint32_t, edge_type, ripples::BackwardDirection<uint32_t>>;
   console->info("Loading...");
-  GraphFwd Gf = ripples::loadGraph<GraphFwd>(CFG, weightGen);
-  GraphBwd G = Gf.get_transpose();
+  GraphBwd G = ripples::loadGraph<GraphBwd>(CFG, weightGen);
   console->info("Loading Done!");
   console->info("Number of Nodes : {}", G.num_nodes());
   console->info("Number of Edges : {}", G.num_edges());